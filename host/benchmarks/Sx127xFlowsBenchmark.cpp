@@ -0,0 +1,152 @@
+/**
+ * @file
+ * @brief SX127x SPI traffic benchmark on host simulator
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#include "jbdrivers/Sx127xSpiDevice.hpp"
+#include "jbdrivers/host/Sx127xSimulator.hpp"
+#include <cstdio>
+
+using namespace ::jblib::jbdrivers;
+using namespace ::jblib::jbdrivers::host;
+
+namespace
+{
+    constexpr int CS_PIN = 15;
+    constexpr uint32_t PACKETS_COUNT = 100;
+    constexpr uint32_t TX_DURATION_READS = 3;
+
+    typedef Sx127xSimulator Sim;
+
+    void setLoraStandby(Sx127xSpiDevice& device)
+    {
+        device.write(Sim::REG_OP_MODE, Sim::MODE_SLEEP);
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_SLEEP);
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_STDBY);
+    }
+
+    void transmit(Sx127xSpiDevice& device, const uint8_t* data, uint8_t size)
+    {
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_STDBY);
+        device.write(Sim::REG_FIFO_ADDR_PTR, device.read(Sim::REG_FIFO_TX_BASE_ADDR));
+        device.write(Sim::REG_FIFO, data, size);
+        device.write(Sim::REG_PAYLOAD_LENGTH, size);
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_TX);
+        while(!(device.read(Sim::REG_IRQ_FLAGS) & Sim::IRQ_TX_DONE)){
+        }
+        device.write(Sim::REG_IRQ_FLAGS, Sim::IRQ_TX_DONE);
+    }
+
+    size_t receive(Sx127xSpiDevice& device, uint8_t* data)
+    {
+        const uint8_t flags = device.read(Sim::REG_IRQ_FLAGS);
+        if(!(flags & Sim::IRQ_RX_DONE)){
+            return 0;
+        }
+        device.write(Sim::REG_IRQ_FLAGS, flags);
+        const uint8_t size = device.read(Sim::REG_RX_NB_BYTES);
+        device.write(Sim::REG_FIFO_ADDR_PTR, device.read(Sim::REG_FIFO_RX_CURRENT_ADDR));
+        device.read(Sim::REG_FIFO, data, size);
+        device.read(Sim::REG_PKT_SNR_VALUE);
+        device.read(Sim::REG_PKT_RSSI_VALUE);
+        return size;
+    }
+
+    void report(const char* flow, uint8_t payloadSize, int clockSpeedHz)
+    {
+        auto statistics = SpiMock::getDeviceStatistics(CS_PIN);
+        printf("%-3s payload %3u B @ %2i MHz: %5.1f transactions/packet, %6.1f bytes/packet, %7.2f us bus time/packet\n",
+                flow, payloadSize, clockSpeedHz / 1000000,
+                static_cast<double>(statistics.transactionsCount) / PACKETS_COUNT,
+                static_cast<double>(statistics.bytesCount) / PACKETS_COUNT,
+                static_cast<double>(statistics.busTimeNs) / PACKETS_COUNT / 1000.0);
+    }
+
+    bool runFlows(uint8_t payloadSize, int clockSpeedHz)
+    {
+        Sx127xSpiDevice::Configuration configuration;
+        configuration.misoPin = 12;
+        configuration.mosiPin = 13;
+        configuration.clkPin = 14;
+        configuration.csPin = CS_PIN;
+        configuration.clockSpeedHz = clockSpeedHz;
+        Sx127xSpiDevice device(configuration);
+        SpiMaster spiMaster(device.getBusConfiguration(), HSPI_HOST, false);
+        spiMaster.addDevice(device);
+
+        Sx127xSimulator simulator;
+        simulator.setTxDurationReads(TX_DURATION_READS);
+        SpiMock::attachModel(CS_PIN, &simulator);
+        setLoraStandby(device);
+
+        uint8_t payload[255];
+        uint8_t received[255];
+        bool isOk = true;
+
+        SpiMock::resetStatistics();
+        for(uint32_t packet = 0; packet < PACKETS_COUNT; packet++){
+            for(uint8_t i = 0; i < payloadSize; i++){
+                payload[i] = static_cast<uint8_t>(packet + i);
+            }
+            transmit(device, payload, payloadSize);
+            const auto& transmitted = simulator.getTransmittedPackets().back();
+            isOk &= (transmitted.size() == payloadSize) && !memcmp(transmitted.data(), payload, payloadSize);
+        }
+        report("TX", payloadSize, clockSpeedHz);
+
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_RX_CONTINUOUS);
+        SpiMock::resetStatistics();
+        for(uint32_t packet = 0; packet < PACKETS_COUNT; packet++){
+            for(uint8_t i = 0; i < payloadSize; i++){
+                payload[i] = static_cast<uint8_t>(packet * 3 + i);
+            }
+            simulator.receivePacket(payload, payloadSize);
+            const size_t size = receive(device, received);
+            isOk &= (size == payloadSize) && !memcmp(received, payload, payloadSize);
+        }
+        report("RX", payloadSize, clockSpeedHz);
+
+        SpiMock::detachModel(CS_PIN);
+        spiMaster.removeDevice(device);
+        return isOk;
+    }
+}
+
+
+
+int main()
+{
+    bool isOk = true;
+    const uint8_t payloadSizes[] = {8, 32, 64};
+    const int clockSpeeds[] = {SPI_MASTER_FREQ_8M, SPI_MASTER_FREQ_10M};
+    for(auto clockSpeedHz : clockSpeeds){
+        for(auto payloadSize : payloadSizes){
+            isOk &= runFlows(payloadSize, clockSpeedHz);
+        }
+    }
+    if(!isOk){
+        printf("Simulated data mismatch\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @brief Host shim of ESP-IDF SPI common definitions
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "esp_err.h"
+
+typedef enum {
+    SPI1_HOST = 0,
+    SPI2_HOST = 1,
+    SPI3_HOST = 2,
+} spi_host_device_t;
+
+#define HSPI_HOST SPI2_HOST
+#define VSPI_HOST SPI3_HOST
+
+#define SPICOMMON_BUSFLAG_MASTER        (1U << 0)
+#define SPICOMMON_BUSFLAG_IOMUX_PINS    (1U << 1)
+#define SPICOMMON_BUSFLAG_SCLK          (1U << 2)
+#define SPICOMMON_BUSFLAG_MISO          (1U << 3)
+#define SPICOMMON_BUSFLAG_MOSI          (1U << 4)
+#define SPICOMMON_BUSFLAG_DUAL          (1U << 5)
+#define SPICOMMON_BUSFLAG_WPHD          (1U << 6)
+#define SPICOMMON_BUSFLAG_QUAD          (SPICOMMON_BUSFLAG_DUAL | SPICOMMON_BUSFLAG_WPHD)
+
+typedef struct {
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+    uint32_t flags;
+    int intr_flags;
+} spi_bus_config_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* busConfig, int dmaChannel);
+esp_err_t spi_bus_free(spi_host_device_t host);
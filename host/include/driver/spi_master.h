@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Host mock of ESP-IDF SPI Master driver API
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "driver/spi_common.h"
+#include "soc/soc.h"
+
+#define SPI_MASTER_FREQ_8M          (APB_CLK_FREQ / 10)
+#define SPI_MASTER_FREQ_9M          (APB_CLK_FREQ / 9)
+#define SPI_MASTER_FREQ_10M         (APB_CLK_FREQ / 8)
+#define SPI_MASTER_FREQ_11M         (APB_CLK_FREQ / 7)
+#define SPI_MASTER_FREQ_13M         (APB_CLK_FREQ / 6)
+#define SPI_MASTER_FREQ_16M         (APB_CLK_FREQ / 5)
+#define SPI_MASTER_FREQ_20M         (APB_CLK_FREQ / 4)
+#define SPI_MASTER_FREQ_26M         (APB_CLK_FREQ / 3)
+#define SPI_MASTER_FREQ_40M         (APB_CLK_FREQ / 2)
+#define SPI_MASTER_FREQ_80M         (APB_CLK_FREQ / 1)
+
+#define SPI_DEVICE_TXBIT_LSBFIRST   (1U << 0)
+#define SPI_DEVICE_RXBIT_LSBFIRST   (1U << 1)
+#define SPI_DEVICE_3WIRE            (1U << 2)
+#define SPI_DEVICE_POSITIVE_CS      (1U << 3)
+#define SPI_DEVICE_HALFDUPLEX       (1U << 4)
+#define SPI_DEVICE_CLK_AS_CS        (1U << 5)
+#define SPI_DEVICE_NO_DUMMY         (1U << 6)
+
+#define SPI_TRANS_MODE_DIO          (1U << 0)
+#define SPI_TRANS_MODE_QIO          (1U << 1)
+#define SPI_TRANS_USE_RXDATA        (1U << 2)
+#define SPI_TRANS_USE_TXDATA        (1U << 3)
+#define SPI_TRANS_MODE_DIOQIO_ADDR  (1U << 4)
+#define SPI_TRANS_VARIABLE_CMD      (1U << 5)
+#define SPI_TRANS_VARIABLE_ADDR     (1U << 6)
+#define SPI_TRANS_VARIABLE_DUMMY    (1U << 7)
+
+typedef uint32_t TickType_t;
+
+struct spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t* transaction);
+
+typedef struct {
+    uint8_t command_bits;
+    uint8_t address_bits;
+    uint8_t dummy_bits;
+    uint8_t mode;
+    uint16_t duty_cycle_pos;
+    uint16_t cs_ena_pretrans;
+    uint8_t cs_ena_posttrans;
+    int clock_speed_hz;
+    int input_delay_ns;
+    int spics_io_num;
+    uint32_t flags;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+struct spi_transaction_t {
+    uint32_t flags;
+    uint16_t cmd;
+    uint64_t addr;
+    size_t length;
+    size_t rxlength;
+    void* user;
+    union {
+        const void* tx_buffer;
+        uint8_t tx_data[4];
+    };
+    union {
+        void* rx_buffer;
+        uint8_t rx_data[4];
+    };
+};
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* deviceConfig,
+        spi_device_handle_t* handle);
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle);
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* transaction);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* transaction);
+int spi_get_actual_clock(int apbClockHz, int clockSpeedHz, int dutyCycle);
+void spi_get_timing(bool isGpioMatrixUsed, int inputDelayNs, int effectiveClockHz, int* dummyBits, int* misoDelay);
+int spi_get_freq_limit(bool isGpioMatrixUsed, int inputDelayNs);
@@ -0,0 +1,78 @@
+/**
+ * @file
+ * @brief Host fake clock for profiler
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "jbdrivers/ProfilerAggregator.hpp"
+
+namespace jblib {
+    namespace jbdrivers {
+        namespace host {
+
+            /// Manually advanced clock standing in for CPU cycle counter on host
+            class FakeClock
+            {
+            public:
+                static uint32_t getTicks() {return ticks();}
+                static void advance(uint32_t ticksCount) {ticks() += ticksCount;}
+                static void set(uint32_t ticksCount) {ticks() = ticksCount;}
+
+            private:
+                static uint32_t& ticks()
+                {
+                    static uint32_t ticks = 0;
+                    return ticks;
+                }
+            };
+
+            /// Scoped probe of target profiler recording into a ring with fake clock timestamps
+            template<size_t SIZE>
+            class FakeClockProbe
+            {
+            public:
+                FakeClockProbe(ProfilerRing<SIZE>& ring, uint16_t probeId) : ring_(ring), probeId_(probeId),
+                        beginTicks_(FakeClock::getTicks())
+                {
+
+                }
+
+                ~FakeClockProbe()
+                {
+                    this->ring_.push(ProfilerRecord_t{this->beginTicks_, FakeClock::getTicks(), this->probeId_});
+                }
+
+                FakeClockProbe(const FakeClockProbe&) = delete;
+                FakeClockProbe& operator=(const FakeClockProbe&) = delete;
+
+            private:
+                ProfilerRing<SIZE>& ring_;
+                const uint16_t probeId_;
+                const uint32_t beginTicks_;
+            };
+
+        }
+    }
+}
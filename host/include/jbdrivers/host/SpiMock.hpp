@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief Host SPI bus mock definition
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "driver/spi_master.h"
+
+namespace jblib {
+    namespace jbdrivers {
+        namespace host {
+
+            /// Slave device model, receives every transaction with matching CS pin
+            class SpiSlaveModel
+            {
+            public:
+                virtual ~SpiSlaveModel() = default;
+                /// txData is nullptr if transaction has no MOSI phase, rxData is nullptr if it has no MISO phase
+                virtual void transfer(uint16_t command, uint64_t address,
+                        const uint8_t* txData, uint8_t* rxData, size_t size) = 0;
+            };
+
+            typedef struct {
+                uint32_t transactionsCount = 0;
+                uint32_t bytesCount = 0;
+                uint64_t busTimeNs = 0;     //< modelled time of all transaction phases on the wires
+            } SpiMockStatistics_t;
+
+            /**
+             * Backend of the spi_master API mock. Transactions are executed synchronously,
+             * bus time is modelled from phase lengths, data lines count and device clock.
+             */
+            class SpiMock
+            {
+            public:
+                static void attachModel(int csPin, SpiSlaveModel* model);
+                static void detachModel(int csPin);
+                static SpiMockStatistics_t getDeviceStatistics(int csPin);
+                static SpiMockStatistics_t getBusStatistics(spi_host_device_t host);
+                static void resetStatistics();
+            };
+
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Host SX127x register level simulator definition
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbdrivers/host/SpiMock.hpp"
+#include <vector>
+
+namespace jblib {
+    namespace jbdrivers {
+        namespace host {
+
+            /**
+             * SX127x LoRa mode register file: FIFO with address pointers, IRQ flags (write 1 to clear)
+             * and operation mode transitions for TX, RX single and RX continuous.
+             * Burst access to register 0x00 streams FIFO, burst access to any other register
+             * increments address, as real chip does.
+             */
+            class Sx127xSimulator : public SpiSlaveModel
+            {
+            public:
+                static constexpr uint8_t REG_FIFO = 0x00;
+                static constexpr uint8_t REG_OP_MODE = 0x01;
+                static constexpr uint8_t REG_FIFO_ADDR_PTR = 0x0D;
+                static constexpr uint8_t REG_FIFO_TX_BASE_ADDR = 0x0E;
+                static constexpr uint8_t REG_FIFO_RX_BASE_ADDR = 0x0F;
+                static constexpr uint8_t REG_FIFO_RX_CURRENT_ADDR = 0x10;
+                static constexpr uint8_t REG_IRQ_FLAGS_MASK = 0x11;
+                static constexpr uint8_t REG_IRQ_FLAGS = 0x12;
+                static constexpr uint8_t REG_RX_NB_BYTES = 0x13;
+                static constexpr uint8_t REG_PKT_SNR_VALUE = 0x19;
+                static constexpr uint8_t REG_PKT_RSSI_VALUE = 0x1A;
+                static constexpr uint8_t REG_PAYLOAD_LENGTH = 0x22;
+                static constexpr uint8_t REG_VERSION = 0x42;
+
+                static constexpr uint8_t OP_MODE_LONG_RANGE = 0x80;
+                static constexpr uint8_t OP_MODE_MASK = 0x07;
+                static constexpr uint8_t MODE_SLEEP = 0x00;
+                static constexpr uint8_t MODE_STDBY = 0x01;
+                static constexpr uint8_t MODE_FSTX = 0x02;
+                static constexpr uint8_t MODE_TX = 0x03;
+                static constexpr uint8_t MODE_FSRX = 0x04;
+                static constexpr uint8_t MODE_RX_CONTINUOUS = 0x05;
+                static constexpr uint8_t MODE_RX_SINGLE = 0x06;
+                static constexpr uint8_t MODE_CAD = 0x07;
+
+                static constexpr uint8_t IRQ_RX_TIMEOUT = 0x80;
+                static constexpr uint8_t IRQ_RX_DONE = 0x40;
+                static constexpr uint8_t IRQ_PAYLOAD_CRC_ERROR = 0x20;
+                static constexpr uint8_t IRQ_VALID_HEADER = 0x10;
+                static constexpr uint8_t IRQ_TX_DONE = 0x08;
+
+                static constexpr uint8_t VERSION = 0x12;
+
+                Sx127xSimulator();
+                void transfer(uint16_t command, uint64_t address,
+                        const uint8_t* txData, uint8_t* rxData, size_t size) override;
+                void reset();
+
+                /// Number of IRQ flags reads after TX start before TxDone is raised
+                void setTxDurationReads(uint32_t reads) {this->txDurationReads_ = reads;}
+                /// Places packet to FIFO as received one. Returns false if chip is not in RX mode.
+                bool receivePacket(const uint8_t* data, uint8_t size, int8_t snr = 0, uint8_t rssi = 0);
+                const std::vector<std::vector<uint8_t>>& getTransmittedPackets() const {return this->transmittedPackets_;}
+                uint8_t getRegister(uint8_t address) const {return this->registers_[address & 0x7F];}
+                uint8_t getMode() const {return this->registers_[REG_OP_MODE] & OP_MODE_MASK;}
+                bool isLoraMode() const {return (this->registers_[REG_OP_MODE] & OP_MODE_LONG_RANGE) != 0;}
+
+            private:
+                uint8_t readRegister(uint8_t address);
+                void writeRegister(uint8_t address, uint8_t value);
+                void setMode(uint8_t opMode);
+                void finishTx();
+
+                uint8_t registers_[128]{};
+                uint8_t fifo_[256]{};
+                uint8_t rxWriteAddress_ = 0;
+                bool isTxActive_ = false;
+                uint32_t txDurationReads_ = 0;
+                uint32_t txReadsLeft_ = 0;
+                std::vector<std::vector<uint8_t>> transmittedPackets_;
+            };
+
+        }
+    }
+}
@@ -0,0 +1,327 @@
+/**
+ * @file
+ * @brief Host SPI bus mock realization
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#include "jbdrivers/host/SpiMock.hpp"
+#include <map>
+
+using namespace ::jblib::jbdrivers::host;
+
+struct spi_device_t
+{
+    spi_host_device_t host;
+    spi_device_interface_config_t configuration;
+};
+
+namespace
+{
+    constexpr size_t HOSTS_COUNT = 3;
+    constexpr int GPIO_MATRIX_DELAY_NS = 25;
+
+    struct BusState
+    {
+        bool isInitialized = false;
+        bool isDmaEnabled = false;
+        spi_bus_config_t configuration{};
+        SpiMockStatistics_t statistics;
+    };
+
+    BusState buses[HOSTS_COUNT];
+    std::map<int, SpiSlaveModel*> models;
+    std::map<int, SpiMockStatistics_t> devicesStatistics;
+
+    uint32_t getPhaseLines(uint32_t flags, bool isDataPhase)
+    {
+        if(!isDataPhase && !(flags & SPI_TRANS_MODE_DIOQIO_ADDR)){
+            return 1;
+        }
+        if(flags & SPI_TRANS_MODE_QIO){
+            return 4;
+        }
+        return (flags & SPI_TRANS_MODE_DIO) ? 2 : 1;
+    }
+
+    int getTimingDummyBits(const spi_device_interface_config_t& configuration)
+    {
+        int timingDummyBits = 0;
+        if(!(configuration.flags & SPI_DEVICE_NO_DUMMY)){
+            spi_get_timing(true, configuration.input_delay_ns,
+                    spi_get_actual_clock(APB_CLK_FREQ, configuration.clock_speed_hz, 128), &timingDummyBits, nullptr);
+        }
+        return timingDummyBits;
+    }
+
+    /// Same argument checks as check_trans_valid() of IDF spi_master driver
+    esp_err_t checkTransaction(spi_device_handle_t handle, spi_transaction_t* transaction)
+    {
+        const auto& configuration = handle->configuration;
+        const auto& bus = buses[handle->host];
+        const bool isHalfDuplex = (configuration.flags & SPI_DEVICE_HALFDUPLEX) != 0;
+        const bool isTxEnabled = (transaction->flags & SPI_TRANS_USE_TXDATA) || transaction->tx_buffer;
+        const bool isRxEnabled = (transaction->flags & SPI_TRANS_USE_RXDATA) || transaction->rx_buffer;
+        const bool isDummyEnabled = configuration.dummy_bits != 0;
+        const bool isExtraDummyEnabled = isHalfDuplex && (getTimingDummyBits(configuration) != 0);
+        const size_t maxTransferBits = 8 * (bus.configuration.max_transfer_sz ? bus.configuration.max_transfer_sz :
+                (bus.isDmaEnabled ? 4092 : 64));
+
+        if(((transaction->flags & SPI_TRANS_USE_RXDATA) && (transaction->rxlength > 32)) ||
+                ((transaction->flags & SPI_TRANS_USE_TXDATA) && (transaction->length > 32)) ||
+                (transaction->length > maxTransferBits) || (transaction->rxlength > maxTransferBits)){
+            return ESP_ERR_INVALID_ARG;
+        }
+        if(!isHalfDuplex && (transaction->rxlength > transaction->length)){
+            return ESP_ERR_INVALID_ARG;
+        }
+        if((transaction->flags & (SPI_TRANS_MODE_DIO | SPI_TRANS_MODE_QIO)) &&
+                (!isHalfDuplex || (configuration.flags & SPI_DEVICE_3WIRE))){
+            return ESP_ERR_INVALID_ARG;
+        }
+        if(isHalfDuplex && bus.isDmaEnabled && isRxEnabled && isTxEnabled){
+            return ESP_ERR_INVALID_ARG;
+        }
+        //MOSI phase is skipped only if it is not enabled, MISO phase too in half duplex
+        if(((transaction->length == 0) && isTxEnabled) || (isHalfDuplex && (transaction->rxlength == 0) && isRxEnabled)){
+            return ESP_ERR_INVALID_ARG;
+        }
+        if(!isHalfDuplex && (transaction->rxlength == 0)){
+            transaction->rxlength = transaction->length;
+        }
+        if(isTxEnabled && isRxEnabled && (isDummyEnabled || isExtraDummyEnabled)){
+            return ESP_ERR_INVALID_ARG;
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t transmit(spi_device_handle_t handle, spi_transaction_t* transaction)
+    {
+        if(!handle || !transaction){
+            return ESP_ERR_INVALID_ARG;
+        }
+        const esp_err_t ret = checkTransaction(handle, transaction);
+        if(ret != ESP_OK){
+            return ret;
+        }
+        const auto& configuration = handle->configuration;
+        const bool isHalfDuplex = (configuration.flags & SPI_DEVICE_HALFDUPLEX) != 0;
+        //in half duplex MOSI and MISO phases follow each other, model sees the longer one
+        const size_t dataBits = (isHalfDuplex && (transaction->rxlength > transaction->length)) ?
+                transaction->rxlength : transaction->length;
+        const size_t size = (dataBits + 7) / 8;
+        if(((transaction->flags & SPI_TRANS_USE_TXDATA) || (transaction->flags & SPI_TRANS_USE_RXDATA)) && (size > 4)){
+            return ESP_ERR_INVALID_ARG;
+        }
+        const uint8_t* txData = (transaction->flags & SPI_TRANS_USE_TXDATA) ? transaction->tx_data :
+                reinterpret_cast<const uint8_t*>(transaction->tx_buffer);
+        if(isHalfDuplex && !transaction->length){
+            txData = nullptr;
+        }
+        uint8_t* rxData = (transaction->flags & SPI_TRANS_USE_RXDATA) ? transaction->rx_data :
+                reinterpret_cast<uint8_t*>(transaction->rx_buffer);
+
+        auto model = models.find(configuration.spics_io_num);
+        if(model != models.end()){
+            model->second->transfer(transaction->cmd, transaction->addr, txData, rxData, size);
+        }
+        else if(rxData){
+            memset(rxData, 0xFF, size);
+        }
+
+        const uint64_t addressBits = configuration.command_bits + configuration.address_bits;
+        const uint64_t lines = getPhaseLines(transaction->flags, false);
+        const uint64_t dataLines = getPhaseLines(transaction->flags, true);
+        uint64_t cycles = (addressBits + lines - 1) / lines + configuration.dummy_bits +
+                (transaction->length + dataLines - 1) / dataLines;
+        if(isHalfDuplex && transaction->rxlength){
+            cycles += getTimingDummyBits(configuration) + (transaction->rxlength + dataLines - 1) / dataLines;
+        }
+        const uint64_t busTimeNs = (cycles * 1000000000ULL) / static_cast<uint64_t>(configuration.clock_speed_hz);
+
+        SpiMockStatistics_t* statistics[] = {&devicesStatistics[configuration.spics_io_num],
+                &buses[handle->host].statistics};
+        for(auto counters : statistics){
+            counters->transactionsCount++;
+            counters->bytesCount += size;
+            counters->busTimeNs += busTimeNs;
+        }
+        return ESP_OK;
+    }
+}
+
+
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* busConfig, int dmaChannel)
+{
+    if((host >= HOSTS_COUNT) || !busConfig){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(buses[host].isInitialized){
+        return ESP_ERR_INVALID_STATE;
+    }
+    buses[host].isInitialized = true;
+    buses[host].isDmaEnabled = dmaChannel != 0;
+    buses[host].configuration = *busConfig;
+    return ESP_OK;
+}
+
+
+
+esp_err_t spi_bus_free(spi_host_device_t host)
+{
+    if(host >= HOSTS_COUNT){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(!buses[host].isInitialized){
+        return ESP_ERR_INVALID_STATE;
+    }
+    buses[host].isInitialized = false;
+    return ESP_OK;
+}
+
+
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* deviceConfig,
+        spi_device_handle_t* handle)
+{
+    if((host >= HOSTS_COUNT) || !deviceConfig || !handle || (deviceConfig->clock_speed_hz <= 0)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(!buses[host].isInitialized){
+        return ESP_ERR_INVALID_STATE;
+    }
+    *handle = new spi_device_t{host, *deviceConfig};
+    return ESP_OK;
+}
+
+
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    if(!handle){
+        return ESP_ERR_INVALID_ARG;
+    }
+    delete handle;
+    return ESP_OK;
+}
+
+
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* transaction)
+{
+    return transmit(handle, transaction);
+}
+
+
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* transaction)
+{
+    return transmit(handle, transaction);
+}
+
+
+
+int spi_get_actual_clock(int apbClockHz, int clockSpeedHz, int dutyCycle)
+{
+    (void)dutyCycle;
+    if(clockSpeedHz >= apbClockHz){
+        return apbClockHz;
+    }
+    const int divider = (apbClockHz + clockSpeedHz - 1) / clockSpeedHz;
+    return apbClockHz / divider;
+}
+
+
+
+void spi_get_timing(bool isGpioMatrixUsed, int inputDelayNs, int effectiveClockHz, int* dummyBits, int* misoDelay)
+{
+    const int apbClocksPerSpiClock = APB_CLK_FREQ / effectiveClockHz;
+    int apbClocksDelay = ((1 + inputDelayNs + (isGpioMatrixUsed ? GPIO_MATRIX_DELAY_NS : 0)) *
+            (APB_CLK_FREQ / 1000)) / 1000 / 1000;
+    if(apbClocksDelay < 0){
+        apbClocksDelay = 0;
+    }
+    const int dummy = apbClocksDelay / apbClocksPerSpiClock;
+    int delay = 0;
+    if(dummy > 0){
+        delay = (dummy + 1) * apbClocksPerSpiClock - apbClocksDelay - 1;
+    }
+    else if(apbClocksDelay * 4 <= apbClocksPerSpiClock){
+        delay = -1;
+    }
+    if(dummyBits){
+        *dummyBits = dummy;
+    }
+    if(misoDelay){
+        *misoDelay = delay;
+    }
+}
+
+
+
+int spi_get_freq_limit(bool isGpioMatrixUsed, int inputDelayNs)
+{
+    int apbClocksDelay = ((1 + inputDelayNs + (isGpioMatrixUsed ? GPIO_MATRIX_DELAY_NS : 0)) *
+            (APB_CLK_FREQ / 1000)) / 1000 / 1000;
+    if(apbClocksDelay < 0){
+        apbClocksDelay = 0;
+    }
+    return APB_CLK_FREQ / (apbClocksDelay + 1);
+}
+
+
+
+void SpiMock::attachModel(int csPin, SpiSlaveModel* model)
+{
+    models[csPin] = model;
+}
+
+
+
+void SpiMock::detachModel(int csPin)
+{
+    models.erase(csPin);
+}
+
+
+
+SpiMockStatistics_t SpiMock::getDeviceStatistics(int csPin)
+{
+    return devicesStatistics[csPin];
+}
+
+
+
+SpiMockStatistics_t SpiMock::getBusStatistics(spi_host_device_t host)
+{
+    return (host < HOSTS_COUNT) ? buses[host].statistics : SpiMockStatistics_t();
+}
+
+
+
+void SpiMock::resetStatistics()
+{
+    devicesStatistics.clear();
+    for(auto& bus : buses){
+        bus.statistics = {};
+    }
+}
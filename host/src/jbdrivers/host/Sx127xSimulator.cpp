@@ -0,0 +1,187 @@
+/**
+ * @file
+ * @brief Host SX127x register level simulator realization
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#include "jbdrivers/host/Sx127xSimulator.hpp"
+
+using namespace ::jblib::jbdrivers::host;
+
+Sx127xSimulator::Sx127xSimulator()
+{
+    this->reset();
+}
+
+
+
+void Sx127xSimulator::reset()
+{
+    memset(this->registers_, 0, sizeof(this->registers_));
+    memset(this->fifo_, 0, sizeof(this->fifo_));
+    this->registers_[REG_OP_MODE] = MODE_STDBY;
+    this->registers_[REG_FIFO_TX_BASE_ADDR] = 0x80;
+    this->registers_[REG_FIFO_RX_BASE_ADDR] = 0x00;
+    this->registers_[REG_PAYLOAD_LENGTH] = 0x01;
+    this->registers_[REG_VERSION] = VERSION;
+    this->rxWriteAddress_ = 0;
+    this->isTxActive_ = false;
+    this->txReadsLeft_ = 0;
+    this->transmittedPackets_.clear();
+}
+
+
+
+void Sx127xSimulator::transfer(uint16_t command, uint64_t address,
+        const uint8_t* txData, uint8_t* rxData, size_t size)
+{
+    const bool isWrite = (command & 1U) != 0;
+    for(size_t i = 0; i < size; i++){
+        const auto registerAddress = static_cast<uint8_t>((address == REG_FIFO) ? REG_FIFO : ((address + i) & 0x7F));
+        if(isWrite){
+            if(rxData){
+                rxData[i] = this->registers_[registerAddress];
+            }
+            this->writeRegister(registerAddress, txData ? txData[i] : 0);
+        }
+        else{
+            const uint8_t value = this->readRegister(registerAddress);
+            if(rxData){
+                rxData[i] = value;
+            }
+        }
+    }
+}
+
+
+
+uint8_t Sx127xSimulator::readRegister(uint8_t address)
+{
+    if(address == REG_FIFO){
+        return this->fifo_[this->registers_[REG_FIFO_ADDR_PTR]++];
+    }
+    if((address == REG_IRQ_FLAGS) && this->isTxActive_){
+        if(this->txReadsLeft_){
+            this->txReadsLeft_--;
+        }
+        else{
+            this->finishTx();
+        }
+    }
+    return this->registers_[address];
+}
+
+
+
+void Sx127xSimulator::writeRegister(uint8_t address, uint8_t value)
+{
+    switch(address){
+        case REG_FIFO:
+            this->fifo_[this->registers_[REG_FIFO_ADDR_PTR]++] = value;
+            break;
+
+        case REG_OP_MODE:
+            this->setMode(value);
+            break;
+
+        case REG_IRQ_FLAGS:
+            this->registers_[REG_IRQ_FLAGS] &= ~value;
+            break;
+
+        case REG_FIFO_RX_CURRENT_ADDR:
+        case REG_RX_NB_BYTES:
+        case REG_PKT_SNR_VALUE:
+        case REG_PKT_RSSI_VALUE:
+        case REG_VERSION:
+            break;
+
+        default:
+            this->registers_[address] = value;
+            break;
+    }
+}
+
+
+
+void Sx127xSimulator::setMode(uint8_t opMode)
+{
+    const uint8_t currentMode = this->getMode();
+    //LongRangeMode bit can be changed only in Sleep mode
+    if(currentMode != MODE_SLEEP){
+        opMode = (opMode & ~OP_MODE_LONG_RANGE) | (this->registers_[REG_OP_MODE] & OP_MODE_LONG_RANGE);
+    }
+    this->registers_[REG_OP_MODE] = opMode;
+    const uint8_t mode = opMode & OP_MODE_MASK;
+    if(!this->isLoraMode()){
+        return;
+    }
+    if((mode == MODE_TX) && !this->isTxActive_){
+        this->isTxActive_ = true;
+        this->txReadsLeft_ = this->txDurationReads_;
+    }
+    else if((mode != MODE_TX) && this->isTxActive_){
+        this->isTxActive_ = false;
+    }
+    if(((mode == MODE_RX_CONTINUOUS) || (mode == MODE_RX_SINGLE)) &&
+            (currentMode != MODE_RX_CONTINUOUS) && (currentMode != MODE_RX_SINGLE)){
+        this->rxWriteAddress_ = this->registers_[REG_FIFO_RX_BASE_ADDR];
+    }
+}
+
+
+
+void Sx127xSimulator::finishTx()
+{
+    const uint8_t base = this->registers_[REG_FIFO_TX_BASE_ADDR];
+    const uint8_t length = this->registers_[REG_PAYLOAD_LENGTH];
+    std::vector<uint8_t> packet(length);
+    for(uint8_t i = 0; i < length; i++){
+        packet[i] = this->fifo_[static_cast<uint8_t>(base + i)];
+    }
+    this->transmittedPackets_.push_back(std::move(packet));
+    this->isTxActive_ = false;
+    this->registers_[REG_IRQ_FLAGS] |= IRQ_TX_DONE;
+    this->registers_[REG_OP_MODE] = (this->registers_[REG_OP_MODE] & ~OP_MODE_MASK) | MODE_STDBY;
+}
+
+
+
+bool Sx127xSimulator::receivePacket(const uint8_t* data, uint8_t size, int8_t snr, uint8_t rssi)
+{
+    const uint8_t mode = this->getMode();
+    if(!this->isLoraMode() || ((mode != MODE_RX_CONTINUOUS) && (mode != MODE_RX_SINGLE))){
+        return false;
+    }
+    const uint8_t start = this->rxWriteAddress_;
+    for(uint8_t i = 0; i < size; i++){
+        this->fifo_[this->rxWriteAddress_++] = data[i];
+    }
+    this->registers_[REG_FIFO_RX_CURRENT_ADDR] = start;
+    this->registers_[REG_RX_NB_BYTES] = size;
+    this->registers_[REG_PKT_SNR_VALUE] = static_cast<uint8_t>(snr * 4);
+    this->registers_[REG_PKT_RSSI_VALUE] = rssi;
+    this->registers_[REG_IRQ_FLAGS] |= IRQ_VALID_HEADER | IRQ_RX_DONE;
+    if(mode == MODE_RX_SINGLE){
+        this->registers_[REG_OP_MODE] = (this->registers_[REG_OP_MODE] & ~OP_MODE_MASK) | MODE_STDBY;
+    }
+    return true;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file
+ * @brief Profiler ring and aggregator test with fake clock
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+
+#include "jbdrivers/host/FakeClock.hpp"
+#include <cstdio>
+
+using namespace ::jblib::jbdrivers;
+using namespace ::jblib::jbdrivers::host;
+
+namespace
+{
+    constexpr uint16_t PROBE_LINEAR = 0;
+    constexpr uint16_t PROBE_WRAP = 1;
+    constexpr uint16_t PROBE_WINDOW = 2;
+    constexpr uint16_t PROBES_COUNT = 3;
+    constexpr uint16_t SAMPLES_PER_PROBE = 128;
+
+    uint32_t failuresCount = 0;
+
+    void check(bool condition, const char* description)
+    {
+        if(!condition){
+            printf("FAIL: %s\n", description);
+            failuresCount++;
+        }
+    }
+
+    template<size_t SIZE>
+    void measure(ProfilerRing<SIZE>& ring, uint16_t probeId, uint32_t durationTicks)
+    {
+        FakeClockProbe<SIZE> probe(ring, probeId);
+        FakeClock::advance(durationTicks);
+    }
+
+    void checkStatistics()
+    {
+        ProfilerRing<256> ring;
+        ProfilerAggregator aggregator(PROBES_COUNT, SAMPLES_PER_PROBE);
+
+        FakeClock::set(1000);
+        for(uint32_t duration = 1; duration <= 100; duration++){
+            measure(ring, PROBE_LINEAR, duration);
+            FakeClock::advance(7);
+        }
+        check(ring.drain(aggregator) == 100, "all records are drained");
+        auto statistics = aggregator.getStatistics(PROBE_LINEAR);
+        check(statistics.count == 100, "linear count");
+        check(statistics.min == 1, "linear min");
+        check(statistics.max == 100, "linear max");
+        check(statistics.average == 50, "linear average");
+        check(statistics.p99 == 100, "linear p99");
+
+        //clock wraps inside probe, end ticks are less than begin ticks
+        for(uint32_t duration = 10; duration <= 40; duration += 10){
+            FakeClock::set(UINT32_MAX - 5);
+            measure(ring, PROBE_WRAP, duration);
+        }
+        ring.drain(aggregator);
+        statistics = aggregator.getStatistics(PROBE_WRAP);
+        check(statistics.count == 4, "wrap count");
+        check(statistics.min == 10, "wrap min");
+        check(statistics.max == 40, "wrap max");
+        check(statistics.average == 25, "wrap average");
+        check(statistics.p99 == 40, "wrap p99");
+
+        //p99 covers latest samplesPerProbe durations, min/max/average cover all of them
+        for(uint32_t i = 0; i < SAMPLES_PER_PROBE; i++){
+            measure(ring, PROBE_WINDOW, 500);
+        }
+        ring.drain(aggregator);
+        for(uint32_t i = 0; i < SAMPLES_PER_PROBE; i++){
+            measure(ring, PROBE_WINDOW, (i < 2) ? 900 : 2);
+        }
+        ring.drain(aggregator);
+        statistics = aggregator.getStatistics(PROBE_WINDOW);
+        check(statistics.count == 2 * SAMPLES_PER_PROBE, "window count");
+        check(statistics.min == 2, "window min");
+        check(statistics.max == 900, "window max");
+        check(statistics.average == (500 * SAMPLES_PER_PROBE + 900 * 2 + 2 * (SAMPLES_PER_PROBE - 2)) /
+                (2 * SAMPLES_PER_PROBE), "window average");
+        check(statistics.p99 == 900, "window p99 over latest samples");
+
+        aggregator.reset();
+        check(aggregator.getStatistics(PROBE_LINEAR).count == 0, "reset clears statistics");
+        check(aggregator.getStatistics(PROBES_COUNT).count == 0, "unknown probe has no statistics");
+    }
+
+    void checkRingOverflow()
+    {
+        ProfilerRing<8> ring;
+        ProfilerAggregator aggregator(PROBES_COUNT, SAMPLES_PER_PROBE);
+        FakeClock::set(0);
+        for(uint32_t i = 0; i < 10; i++){
+            measure(ring, PROBE_LINEAR, 3);
+        }
+        check(ring.getDroppedCount() == 2, "records over ring size are dropped");
+        check(ring.drain(aggregator) == 8, "ring keeps size records");
+        check(aggregator.getStatistics(PROBE_LINEAR).count == 8, "kept records are aggregated");
+        measure(ring, PROBE_LINEAR, 3);
+        check(ring.drain(aggregator) == 1, "ring accepts records after drain");
+    }
+}
+
+
+
+int main()
+{
+    checkStatistics();
+    checkRingOverflow();
+    if(failuresCount){
+        printf("%u checks failed\n", static_cast<unsigned>(failuresCount));
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
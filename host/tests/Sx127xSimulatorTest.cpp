@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @brief SX127x simulator register, FIFO and IRQ flags test through Sx127xSpiDevice
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+
+#include "jbdrivers/Sx127xSpiDevice.hpp"
+#include "jbdrivers/host/Sx127xSimulator.hpp"
+#include <cstdio>
+#include <cstring>
+
+using namespace ::jblib::jbdrivers;
+using namespace ::jblib::jbdrivers::host;
+
+namespace
+{
+    constexpr int CS_PIN = 15;
+    constexpr uint32_t TX_DURATION_READS = 2;
+
+    typedef Sx127xSimulator Sim;
+
+    uint32_t failuresCount = 0;
+
+    void check(bool condition, const char* description)
+    {
+        if(!condition){
+            printf("FAIL: %s\n", description);
+            failuresCount++;
+        }
+    }
+
+    void checkRegisters(Sx127xSpiDevice& device, Sim& simulator)
+    {
+        check(device.read(Sim::REG_VERSION) == Sim::VERSION, "version register");
+        device.write(Sim::REG_VERSION, 0x55);
+        check(device.read(Sim::REG_VERSION) == Sim::VERSION, "version register is read only");
+
+        device.write(Sim::REG_PAYLOAD_LENGTH, 0x2A);
+        check(device.read(Sim::REG_PAYLOAD_LENGTH) == 0x2A, "register write/read round trip");
+
+        const uint8_t burst[] = {0x11, 0x22, 0x33};
+        uint8_t readBack[sizeof(burst)] = {};
+        device.write(Sim::REG_FIFO_ADDR_PTR, burst, sizeof(burst));
+        device.read(Sim::REG_FIFO_ADDR_PTR, readBack, sizeof(readBack));
+        check(!memcmp(burst, readBack, sizeof(burst)), "burst access increments register address");
+        check(simulator.getRegister(Sim::REG_FIFO_RX_BASE_ADDR) == 0x33, "burst write reaches next registers");
+
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_STDBY);
+        check(!simulator.isLoraMode(), "long range bit is locked outside sleep");
+        device.write(Sim::REG_OP_MODE, Sim::MODE_SLEEP);
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_SLEEP);
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_STDBY);
+        check(simulator.isLoraMode() && (simulator.getMode() == Sim::MODE_STDBY), "LoRa standby after sleep");
+    }
+
+    void checkTransmit(Sx127xSpiDevice& device, Sim& simulator)
+    {
+        const uint8_t payload[] = {0xDE, 0xAD, 0xBE, 0xEF, 0x01};
+        device.write(Sim::REG_FIFO_TX_BASE_ADDR, 0x80);
+        device.write(Sim::REG_FIFO_ADDR_PTR, device.read(Sim::REG_FIFO_TX_BASE_ADDR));
+        device.write(Sim::REG_FIFO, payload, sizeof(payload));
+        check(simulator.getRegister(Sim::REG_FIFO_ADDR_PTR) == 0x80 + sizeof(payload),
+                "FIFO burst advances address pointer");
+        device.write(Sim::REG_PAYLOAD_LENGTH, sizeof(payload));
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_TX);
+        check(simulator.getMode() == Sim::MODE_TX, "TX mode");
+
+        for(uint32_t i = 0; i < TX_DURATION_READS; i++){
+            check(!(device.read(Sim::REG_IRQ_FLAGS) & Sim::IRQ_TX_DONE), "TxDone is not raised before TX duration");
+        }
+        check(device.read(Sim::REG_IRQ_FLAGS) & Sim::IRQ_TX_DONE, "TxDone is raised after TX duration");
+        check(simulator.getMode() == Sim::MODE_STDBY, "standby after TX");
+        device.write(Sim::REG_IRQ_FLAGS, Sim::IRQ_TX_DONE);
+        check(!(device.read(Sim::REG_IRQ_FLAGS) & Sim::IRQ_TX_DONE), "TxDone is cleared by writing 1");
+
+        const auto& packets = simulator.getTransmittedPackets();
+        check(packets.size() == 1, "one packet transmitted");
+        check(!packets.empty() && (packets.back().size() == sizeof(payload)) &&
+                !memcmp(packets.back().data(), payload, sizeof(payload)), "transmitted packet matches FIFO");
+    }
+
+    void checkReceive(Sx127xSpiDevice& device, Sim& simulator)
+    {
+        const uint8_t payload[] = {0x10, 0x20, 0x30, 0x40};
+        check(!simulator.receivePacket(payload, sizeof(payload)), "packet is not received in standby");
+
+        device.write(Sim::REG_FIFO_RX_BASE_ADDR, 0x00);
+        device.write(Sim::REG_OP_MODE, Sim::OP_MODE_LONG_RANGE | Sim::MODE_RX_SINGLE);
+        check(simulator.receivePacket(payload, sizeof(payload), -2, 100), "packet is received in RX single");
+        check(simulator.getMode() == Sim::MODE_STDBY, "standby after RX single");
+
+        const uint8_t flags = device.read(Sim::REG_IRQ_FLAGS);
+        check((flags & (Sim::IRQ_RX_DONE | Sim::IRQ_VALID_HEADER)) == (Sim::IRQ_RX_DONE | Sim::IRQ_VALID_HEADER),
+                "RxDone and ValidHeader are raised");
+        check(device.read(Sim::REG_RX_NB_BYTES) == sizeof(payload), "RX bytes count");
+        check(device.read(Sim::REG_PKT_SNR_VALUE) == static_cast<uint8_t>(-2 * 4), "packet SNR");
+        check(device.read(Sim::REG_PKT_RSSI_VALUE) == 100, "packet RSSI");
+
+        uint8_t received[sizeof(payload)] = {};
+        device.write(Sim::REG_FIFO_ADDR_PTR, device.read(Sim::REG_FIFO_RX_CURRENT_ADDR));
+        device.read(Sim::REG_FIFO, received, sizeof(received));
+        check(!memcmp(received, payload, sizeof(payload)), "FIFO read at RX current address");
+
+        device.write(Sim::REG_IRQ_FLAGS, flags);
+        check(device.read(Sim::REG_IRQ_FLAGS) == 0, "RX flags are cleared by writing 1");
+    }
+}
+
+
+
+int main()
+{
+    Sx127xSpiDevice::Configuration configuration;
+    configuration.misoPin = 12;
+    configuration.mosiPin = 13;
+    configuration.clkPin = 14;
+    configuration.csPin = CS_PIN;
+    configuration.clockSpeedHz = SPI_MASTER_FREQ_8M;
+    Sx127xSpiDevice device(configuration);
+    SpiMaster spiMaster(device.getBusConfiguration(), HSPI_HOST, false);
+    spiMaster.addDevice(device);
+
+    Sx127xSimulator simulator;
+    simulator.setTxDurationReads(TX_DURATION_READS);
+    SpiMock::attachModel(CS_PIN, &simulator);
+
+    checkRegisters(device, simulator);
+    checkTransmit(device, simulator);
+    checkReceive(device, simulator);
+
+    SpiMock::detachModel(CS_PIN);
+    spiMaster.removeDevice(device);
+
+    //half duplex register access enables only the used data phase, so dummy cycles are allowed
+    configuration.isHalfDuplex = true;
+    configuration.dummyBits = 2;
+    Sx127xSpiDevice halfDuplexDevice(configuration);
+    SpiMaster halfDuplexSpiMaster(halfDuplexDevice.getBusConfiguration(), VSPI_HOST, false);
+    halfDuplexSpiMaster.addDevice(halfDuplexDevice);
+    Sx127xSimulator halfDuplexSimulator;
+    SpiMock::attachModel(CS_PIN, &halfDuplexSimulator);
+    checkRegisters(halfDuplexDevice, halfDuplexSimulator);
+    SpiMock::detachModel(CS_PIN);
+    halfDuplexSpiMaster.removeDevice(halfDuplexDevice);
+    if(failuresCount){
+        printf("%u checks failed\n", static_cast<unsigned>(failuresCount));
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Boot Timing class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+
+#if CONFIG_BOOT_TIMING_ENABLE
+
+#include <atomic>
+
+/// Records end of boot phase, compiles to nothing if boot timing is disabled
+#define JB_BOOT_MARK(phase) ::jblib::jbdrivers::BootTiming::mark(phase)
+
+namespace jblib {
+    namespace jbdrivers {
+
+        /**
+         * Marks of boot phases with esp_timer time since startup. Phase duration is the time
+         * since the previous mark, the first phase starts at esp_timer start.
+         */
+        class BootTiming
+        {
+        public:
+            typedef struct {
+                const char* phase;      //< nullptr while mark is being written
+                int64_t timeUs;
+            } Mark_t;
+
+            /// Phase name must be a string with static storage duration. Thread-safe, lock-free
+            static void mark(const char* phase);
+            static size_t getMarksCount();
+            static Mark_t getMark(size_t index);
+            /// Logs every phase with its end time and duration
+            static void print();
+
+        private:
+            static constexpr const char* logTag_ = "[ Boot Timing ]";
+            static constexpr uint32_t MARKS_COUNT = CONFIG_BOOT_TIMING_MARKS_COUNT;
+            static Mark_t marks_[MARKS_COUNT];
+            static std::atomic<uint32_t> marksCount_;
+        };
+
+    }
+}
+
+#else
+
+#define JB_BOOT_MARK(phase)
+
+#endif
@@ -27,6 +27,8 @@
 
 #include "jbkernel/jb_common.h"
 #include "jbdrivers/GpioInterrupt.hpp"
+#include "driver/pcnt.h"
+#include <atomic>
 #include <memory>
 
 namespace jblib {
@@ -39,18 +41,76 @@ namespace jblib {
                 STATE_LEFT = 1,
                 STATE_RIGHT = 2
             }State_t;
-            Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, bool useInterrupt = true);
+
+            typedef enum{
+                MODE_POLLING = 0,
+                MODE_INTERRUPT = 1,
+                MODE_PCNT = 2,      //< hardware quadrature counting, no CPU load per edge
+                MODE_QUADRATURE = 3,//< both edges of both pins decoded by state table, no filter delay, opt-in by mode
+            }Mode_t;
+
+            struct PcntConfiguration
+            {
+                pcnt_unit_t unit = PCNT_UNIT_0;
+                uint16_t filterValue = 1023;    //< pulses shorter than this number of APB clocks are ignored, max 1023
+                int16_t countLimit = 16384;     //< counter is moved to 32-bit position on reaching +-limit
+                uint8_t stepsPerDetent = 4;     //< quadrature counts between detents, used by getState()
+            };
+
+            Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, bool useInterrupt = true);  //< interrupt means MODE_INTERRUPT
+            Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, Mode_t mode, uint8_t stepsPerDetent = 4);
+            Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, const PcntConfiguration& configuration);
+            ~Encoder();
             State_t getState();
             void resetState();
+            /// Signed position in quadrature counts, MODE_PCNT only
+            int32_t getPosition();
+            void resetPosition();
+            /// Counts per second since previous call, MODE_PCNT only
+            float getVelocity();
+            /**
+             * Drains decoded steps (+1 right, -1 left) queued by interrupt, MODE_QUADRATURE only.
+             * getState() drains the same queue, so use one of them.
+             * @return number of copied steps
+             */
+            size_t readSteps(int8_t* steps, size_t maxCount);
+            /// Number of impossible transitions (both pins changed at once) rejected as noise
+            uint32_t getInvalidTransitionsCount() const;
+
         private:
             static constexpr const char* logTag_ = "[ Encoder ]";
+            static constexpr int64_t MIN_VELOCITY_PERIOD_US = 1000;
+            static constexpr uint32_t STEPS_QUEUE_SIZE = CONFIG_ENCODER_STEPS_QUEUE_SIZE;
+            static_assert((STEPS_QUEUE_SIZE & (STEPS_QUEUE_SIZE - 1)) == 0, "Steps queue size must be a power of 2");
+            //index is (previous state << 2) | current state, state is (e1 << 1) | e2
+            static constexpr int8_t QUADRATURE_TABLE[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+            static constexpr uint16_t QUADRATURE_INVALID_MASK = (1 << 3) | (1 << 6) | (1 << 9) | (1 << 12);
             gpio_num_t e1Pin_ = GPIO_NUM_NC;
             gpio_num_t e2Pin_ = GPIO_NUM_NC;
             std::unique_ptr<jblib::jbdrivers::GpioInterrupt> gpioInterrupt_;
+            std::unique_ptr<jblib::jbdrivers::GpioInterrupt> e1Interrupt_;
             State_t state_ = STATE_IDLE;
-            bool useInterrupt_ = true;
+            Mode_t mode_ = MODE_INTERRUPT;
             bool checkEncoder_ = false;
-            xQueueHandle filterSem_ = xSemaphoreCreateBinary();
+            PcntConfiguration pcntConfig_;
+            std::atomic<int32_t> overflowPosition_{0};
+            int32_t statePosition_ = 0;
+            int32_t velocityPosition_ = 0;
+            int64_t velocityTimeUs_ = 0;
+            float velocity_ = 0;
+            uint8_t stepsPerDetent_ = 4;
+            int32_t pendingSteps_ = 0;
+            uint8_t quadratureState_ = 0;
+            uint32_t invalidTransitionsCount_ = 0;
+            int8_t steps_[STEPS_QUEUE_SIZE] = {};
+            std::atomic<uint32_t> stepsHead_{0};
+            std::atomic<uint32_t> stepsTail_{0};
+
+            static void pcntIsrHandler(void* arg);
+            void initializePcnt();
+            void initializeInterrupt();
+            void initializeQuadrature();
+            void decodeQuadrature();
         };
     }
 }
@@ -28,6 +28,10 @@
 #include "jbkernel/jb_common.h"
 #include "jbkernel/callback_interfaces.hpp"
 #include "jbdrivers/JbController.hpp"
+#include "jbdrivers/GpioRearmService.hpp"
+#include "jbdrivers/GpioInterruptDispatcher.hpp"
+#include "jbdrivers/IsrDelegate.hpp"
+#include <memory>
 
 namespace jblib {
     namespace jbdrivers {
@@ -41,21 +45,86 @@ namespace jblib {
                 gpio_pullup_t pullUp = GPIO_PULLUP_DISABLE;
                 gpio_pulldown_t pullDown = GPIO_PULLDOWN_DISABLE;
                 gpio_int_type_t edge = GPIO_INTR_ANYEDGE;
+                bool captureEdges = false;  //< store ISR entry timestamps of edges in a ring
+                uint32_t maxEdgesPerSecond = 0; //< edge rate limit, 0 - no limit. Pin is masked and polled on exceeding
+                uint32_t settleTimeMs = 50;     //< pin level must be stable this time to unmask after storm.
+                                                //< Meanwhile pin is polled, level changes are passed to callback from timer task
             };
 
+            typedef struct {
+                uint32_t edgesCount = 0;
+                uint32_t stormsCount = 0;
+                bool isStormActive = false;
+            } Statistics_t;
+
             static void globalEnableGpioInterrupt(uint32_t intrFlags = ESP_INTR_FLAG_LOWMED);
             static void globalDisableGpioInterrupt();
+            /// Batched mode: one ISR for all pins, all callbacks are called from dispatcher task. Install before creating objects
+            static void globalEnableBatchedGpioInterrupt(uint32_t intrFlags = ESP_INTR_FLAG_LOWMED);
 
             explicit GpioInterrupt(const Configuration& config);
             ~GpioInterrupt() override;
             void enable();
             void disable();
+            /**
+             * Allocation-free callback, called instead of addCallback() one if set. See IsrDelegate for IRAM use.
+             * Called from ISR, in batched mode from dispatcher task as all other callbacks
+             */
+            void addIsrCallback(const IsrDelegate& callback, void* parameter = nullptr);
+            void deleteIsrCallback();
+            /// Disables interrupt and re-enables it after at least delayMs by shared re-arm service. ISR safe
+            void disableFor(uint32_t delayMs);
+            /// Moves up to maxCount oldest unread edge timestamps, capture mode only. @return number of timestamps
+            size_t readCaptures(int64_t* timestampsUs, size_t maxCount);
+            /// Total number of captured edges
+            uint32_t getCapturesCount();
+            /// Edges overwritten in the ring before they were read
+            uint32_t getCapturesOverflowCount();
+            /// Interval between two last edges, 0 if less than two edges were captured
+            int64_t getLastIntervalUs();
+            /// Average edges frequency over edges kept in the ring, 0 if less than two edges were captured
+            float getFrequency();
+            Statistics_t getStatistics() const;
 
         private:
+            friend class GpioRearmService;
+            friend class GpioInterruptDispatcher;
             static constexpr const char* logTag_ = "[ Gpio Intr ]";
             gpio_num_t pin_ = static_cast<gpio_num_t>(-1);
+            GpioRearmService* rearmService_ = nullptr;   //< taken in constructor, ISR doesn't call getter
+            GpioInterrupt* rearmNext_ = nullptr;
+            uint32_t rearmTick_ = 0;
+            bool isRearmPending_ = false;
+            GpioInterrupt* notifyNext_ = nullptr;
+            bool isNotifyPending_ = false;
+            bool isStormEdge_ = false;  //< polled level change matching edge, set by onRearm()
+            bool isBatched_ = false;
+            IsrDelegate isrCallback_;
+            static constexpr uint32_t CAPTURE_RING_SIZE = CONFIG_GPIO_CAPTURE_RING_SIZE;
+            static_assert((CAPTURE_RING_SIZE & (CAPTURE_RING_SIZE - 1)) == 0, "Capture ring size must be a power of 2");
+            std::unique_ptr<int64_t[]> captures_;
+            uint32_t capturesHead_ = 0;
+            uint32_t capturesTail_ = 0;
+            uint32_t capturesOverflowCount_ = 0;
+            portMUX_TYPE captureMutex_;
+            portMUX_TYPE callbackMutex_;    //< ISR takes a copy of delegate and parameter under it
 
             static void isrHandler(void* arg);
+            static constexpr int64_t RATE_WINDOW_US = 100000;
+            uint32_t windowEdgesLimit_ = 0;
+            uint32_t settleTicks_ = 0;
+            int64_t windowStartUs_ = 0;
+            uint32_t windowEdges_ = 0;
+            uint32_t stableTicks_ = 0;
+            int stormLevel_ = 0;
+            gpio_int_type_t edge_ = GPIO_INTR_ANYEDGE;
+            Statistics_t statistics_;
+
+            void capture(int64_t timestampUs);
+            bool processEdge(int64_t timestampUs);
+            uint32_t onRearm();
+            void onStormEdge();
+            void callCallback();
         };
 
     }
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @brief GPIO Interrupt Dispatcher class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace jblib {
+    namespace jbdrivers {
+
+        class GpioInterrupt;
+
+        /**
+         * Batched GPIO interrupt mode. A single ISR snapshots interrupt status of all pins,
+         * clears it and pushes (pins mask, timestamp) event to a ring, then one dispatcher task
+         * calls callbacks of GpioInterrupt objects for every pin of the event.
+         * ISR time doesn't depend on number of pins, callbacks run in task context.
+         * Replaces IDF GPIO ISR service, only edge interrupts are supported.
+         */
+        class GpioInterruptDispatcher
+        {
+        public:
+            static void install(uint32_t intrFlags = ESP_INTR_FLAG_LOWMED) noexcept(false);
+            static void uninstall();
+            /// @return nullptr if batched mode is not installed
+            static GpioInterruptDispatcher* getGpioInterruptDispatcher();
+            GpioInterruptDispatcher(const GpioInterruptDispatcher&) = delete;
+            GpioInterruptDispatcher& operator=(const GpioInterruptDispatcher&) = delete;
+            void addPin(gpio_num_t pin, GpioInterrupt& interrupt);
+            void removePin(gpio_num_t pin);
+            /// Timestamp of currently dispatched event, valid inside callback only
+            int64_t getEventTimeUs() const {return this->eventTimeUs_;}
+            /**
+             * Events merged into one overflow mask due to full ring. Their pins are dispatched anyway,
+             * with ISR timestamp of the earliest merged event
+             */
+            uint32_t getDroppedEventsCount() const {return this->droppedEventsCount_;}
+
+        private:
+            typedef struct {
+                uint64_t pinsMask;
+                int64_t timestampUs;
+            } Event_t;
+
+            static constexpr const char* logTag_ = "[ Gpio Dispatch ]";
+            static constexpr uint32_t QUEUE_SIZE = CONFIG_GPIO_DISPATCHER_QUEUE_SIZE;
+            static_assert((QUEUE_SIZE & (QUEUE_SIZE - 1)) == 0, "Dispatcher queue size must be a power of 2");
+            static GpioInterruptDispatcher* dispatcher_;
+
+            explicit GpioInterruptDispatcher(uint32_t intrFlags);
+            ~GpioInterruptDispatcher();
+            static void isrHandler(void* arg);
+            void dispatcher();
+            void dispatch(uint64_t pinsMask, int64_t timestampUs);
+
+            gpio_isr_handle_t isrHandle_ = nullptr;
+            SemaphoreHandle_t eventSemaphore_ = nullptr;
+            std::thread dispatcherThread_;
+            std::atomic<bool> isRunning_{false};
+            std::recursive_mutex pinsMutex_;
+            GpioInterrupt* pins_[GPIO_NUM_MAX] = {};
+            Event_t events_[QUEUE_SIZE] = {};
+            std::atomic<uint32_t> eventsHead_{0};
+            std::atomic<uint32_t> eventsTail_{0};
+            portMUX_TYPE overflowMutex_;
+            uint64_t overflowMask_ = 0;
+            int64_t overflowTimestampUs_ = 0;  //< ISR time of the first event merged into overflowMask_
+            uint32_t droppedEventsCount_ = 0;
+            int64_t eventTimeUs_ = 0;
+        };
+
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file
+ * @brief GPIO Interrupt Re-arm Service class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "freertos/timers.h"
+
+namespace jblib {
+    namespace jbdrivers {
+
+        class GpioInterrupt;
+
+        /**
+         * Re-enables disabled GPIO interrupts after a delay. One FreeRTOS software timer drives
+         * a timer wheel of intrusive lists, so RAM and task count don't depend on number of inputs.
+         * The timer runs only while something is pending.
+         */
+        class GpioRearmService
+        {
+        public:
+            /// Creates service on first call, call it from task context and keep the reference for ISR
+            static GpioRearmService& getGpioRearmService();
+            GpioRearmService(const GpioRearmService&) = delete;
+            GpioRearmService& operator=(const GpioRearmService&) = delete;
+            /// Schedules interrupt enable after at least delayMs. Can be called from ISR
+            void rearmAfter(GpioInterrupt& interrupt, uint32_t delayMs);
+            void cancel(GpioInterrupt& interrupt);
+            uint32_t getPendingCount() const;
+
+        private:
+            static constexpr const char* logTag_ = "[ Gpio Rearm ]";
+            static constexpr uint32_t WHEEL_SIZE = CONFIG_GPIO_REARM_WHEEL_SIZE;
+            static constexpr uint32_t TICK_MS = CONFIG_GPIO_REARM_TICK_MS;
+            static_assert((WHEEL_SIZE & (WHEEL_SIZE - 1)) == 0, "Re-arm wheel size must be a power of 2");
+
+            GpioRearmService();
+            static void timerCallback(TimerHandle_t timer);
+            void processTick();
+            void unlink(GpioInterrupt& interrupt);
+            void insert(GpioInterrupt& interrupt, uint32_t tick);
+
+            mutable portMUX_TYPE mutex_;
+            TimerHandle_t timer_ = nullptr;
+            StaticTimer_t timerBuffer_;
+            GpioInterrupt* wheel_[WHEEL_SIZE] = {};
+            GpioInterrupt* notifyHead_ = nullptr;   //< storm-masked pins which polled level changed
+            uint32_t currentTick_ = 0;
+            uint32_t pendingCount_ = 0;
+            bool isRunning_ = false;
+        };
+
+    }
+}
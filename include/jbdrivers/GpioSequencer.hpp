@@ -0,0 +1,107 @@
+/**
+ * @file
+ * @brief GPIO Sequencer class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "jbdrivers/JbController.hpp"
+#include "jbdrivers/VoidTimer.hpp"
+
+namespace jblib {
+    namespace jbdrivers {
+
+        /**
+         * Plays waveform patterns on board GPIOs from one VoidTimer interrupt.
+         * All channels that change level in a tick are switched together by set/clear register writes.
+         * Timer runs only while some channel is playing.
+         */
+        class GpioSequencer
+        {
+        public:
+            /**
+             * Pattern is a series of pulses followed by a pause:
+             * (onTicks high, offTicks low) * pulsesCount, pauseTicks low, then repeated.
+             * Durations are in sequencer ticks.
+             */
+            struct Pattern
+            {
+                uint16_t onTicks;
+                uint16_t offTicks;
+                uint16_t pauseTicks;
+                uint8_t pulsesCount;
+                uint8_t repeatsCount;   //< 0 - repeat forever, otherwise pin is set low after last repeat
+            };
+
+            static constexpr Pattern getPwmPattern(uint16_t periodTicks, uint16_t onTicks)
+            {
+                return Pattern{onTicks, static_cast<uint16_t>(periodTicks - onTicks), 0, 1, 0};
+            }
+
+            static constexpr Pattern getBlinkCodePattern(uint8_t blinksCount, uint16_t onTicks, uint16_t offTicks,
+                    uint16_t pauseTicks, uint8_t repeatsCount = 0)
+            {
+                return Pattern{onTicks, offTicks, pauseTicks, blinksCount, repeatsCount};
+            }
+
+            GpioSequencer(VoidTimer& timer, uint32_t tickUs = 1000);
+            ~GpioSequencer();
+            GpioSequencer(const GpioSequencer&) = delete;
+            GpioSequencer& operator=(const GpioSequencer&) = delete;
+            void play(uint8_t boardGpio, const Pattern& pattern);
+            void stop(uint8_t boardGpio, bool level = false);
+            bool isPlaying(uint8_t boardGpio);
+
+        private:
+            typedef enum{
+                PHASE_ON = 0,
+                PHASE_OFF,
+                PHASE_PAUSE,
+            }Phase_t;
+
+            struct Channel
+            {
+                Pattern pattern;
+                uint32_t lowMask;
+                uint32_t highMask;
+                uint16_t remainingTicks;
+                uint8_t pulse;
+                uint8_t repeat;
+                Phase_t phase;
+                bool isActive;
+            };
+
+            static constexpr const char* logTag_ = "[ Gpio Seq ]";
+            VoidTimer& timer_;
+            portMUX_TYPE mutex_;
+            Channel channels_[JbController::BOARD_GPIOS_COUNT] = {};
+            bool isTimerRunning_ = false;
+
+            void tick();
+            static bool nextPhase(Channel& channel);
+            static void writeMasks(uint32_t lowOnMask, uint32_t lowOffMask, uint32_t highOnMask, uint32_t highOffMask);
+        };
+
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief ISR Delegate class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include <cstring>
+#include <type_traits>
+
+namespace jblib {
+    namespace jbdrivers {
+
+        /**
+         * Fixed-capacity callback for ISR paths. Callable object is stored inside the delegate,
+         * it is never heap allocated. Invocation goes through an IRAM placed thunk which is flattened,
+         * so with optimization enabled a small callable (e.g. lambda capturing this) is inlined into it
+         * and call doesn't touch flash. At -O0 lambda body may be emitted in flash: if ISR must run
+         * with cache disabled, build with optimization or pass IRAM_ATTR function.
+         * Functions passed by pointer must be IRAM_ATTR themselves.
+         * Copy isn't atomic, owner must serialize assignment against invocation.
+         */
+        class IsrDelegate
+        {
+        public:
+            static constexpr size_t CAPACITY = 4 * sizeof(void*);
+
+            IsrDelegate() = default;
+
+            template<typename F>
+            IsrDelegate(F function) : invoker_(&invoke<F>)   // NOLINT: implicit conversion from callable is intended
+            {
+                static_assert(sizeof(F) <= CAPACITY, "Callable captures don't fit into ISR delegate");
+                static_assert(alignof(F) <= alignof(void*), "Callable alignment is too big for ISR delegate");
+                static_assert(std::is_trivially_copyable<F>::value && std::is_trivially_destructible<F>::value,
+                        "ISR delegate callable must be trivially copyable and destructible");
+                memcpy(this->storage_, &function, sizeof(F));
+            }
+
+            inline IsrDelegate(const IsrDelegate& other) __attribute__((always_inline)) : invoker_(other.invoker_)
+            {
+                memcpy(this->storage_, other.storage_, CAPACITY);
+            }
+
+            inline IsrDelegate& operator=(const IsrDelegate& other) __attribute__((always_inline))
+            {
+                memcpy(this->storage_, other.storage_, CAPACITY);
+                this->invoker_ = other.invoker_;
+                return *this;
+            }
+
+            inline explicit operator bool() const __attribute__((always_inline))
+            {
+                return this->invoker_ != nullptr;
+            }
+
+            inline void operator()(void* source, void* parameter) const __attribute__((always_inline))
+            {
+                this->invoker_(this->storage_, source, parameter);
+            }
+
+        private:
+            typedef void (*Invoker_t)(const void* storage, void* source, void* parameter);
+
+            template<typename F>
+            static void IRAM_ATTR __attribute__((flatten)) invoke(const void* storage, void* source, void* parameter)
+            {
+                (*reinterpret_cast<const F*>(storage))(source, parameter);
+            }
+
+            alignas(void*) uint8_t storage_[CAPACITY] = {};
+            Invoker_t invoker_ = nullptr;
+        };
+
+    }
+}
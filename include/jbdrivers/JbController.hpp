@@ -46,19 +46,211 @@ using namespace jbkernel;
 
 class JbController : public JbKernel
 {
+private:
+    static constexpr BoardGpio_t boardGpios_[] = JBCONTROLLER_BOARD_GPIOS;
+
 public:
+    static constexpr size_t SERIAL_LENGTH = sizeof("0000-0000-0000");
+    static constexpr size_t MAC_STRING_LENGTH = sizeof("00:00:00:00:00:00");
+
+    typedef struct {
+        char serial[SERIAL_LENGTH];
+        char macString[MAC_STRING_LENGTH];
+        uint8_t mac[6];
+        uint8_t chipRevision;
+        uint8_t coresCount;
+        uint32_t flashId;       //< JEDEC manufacturer and device ID
+        uint32_t flashSize;
+    } Identity_t;
+
+    static constexpr uint8_t BOARD_GPIOS_COUNT = sizeof(boardGpios_) / sizeof(boardGpios_[0]);
+
 	static void initialize();
 	static void gpioOn(uint8_t number);
 	static void gpioOff(uint8_t number);
 	static void gpioTgl(uint8_t number);
     static bool getGpio(uint8_t number);
-    static char* getSerial();
+    /**
+     * Device identity is read once, during initialize() or on first request from any task,
+     * then all lookups return the same static block.
+     */
+    static const Identity_t& getIdentity();
+    static const char* getSerial() {return getIdentity().serial;}
+    static const char* getMacString() {return getIdentity().macString;}
+    static uint8_t getChipRevision() {return getIdentity().chipRevision;}
+    static uint32_t getFlashId() {return getIdentity().flashId;}
+
+    /**
+     * Board GPIO set operations, bit N of indices selects board GPIO N, so only first 64 board GPIOs
+     * can be selected. All pins of a register are switched by a single write
+     * to GPIO.out_w1ts/out_w1tc (out1 for pins 32..39).
+     */
+    static void gpioSetOn(uint64_t indices);
+    static void gpioSetOff(uint64_t indices);
+    /**
+     * Read-modify-write of GPIO.out (out1) under spinlock, all pins of a register change at once.
+     * Pins of the same register driven by gpio_set_level() or other accessors
+     * from another core or ISR meanwhile may get their change lost.
+     */
+    static void gpioSetTgl(uint64_t indices);
+
+    /// Single board GPIO accessors resolved at compile time to one register access
+    template<uint8_t NUMBER>
+    static void gpioOn()
+    {
+        static_assert(NUMBER < BOARD_GPIOS_COUNT, "Board GPIO number is out of range");
+        writeMasks<getGpioLowMask(NUMBER), getGpioHighMask(NUMBER)>(GPIO.out_w1ts, GPIO.out1_w1ts.val);
+    }
+
+    template<uint8_t NUMBER>
+    static void gpioOff()
+    {
+        static_assert(NUMBER < BOARD_GPIOS_COUNT, "Board GPIO number is out of range");
+        writeMasks<getGpioLowMask(NUMBER), getGpioHighMask(NUMBER)>(GPIO.out_w1tc, GPIO.out1_w1tc.val);
+    }
+
+    template<uint8_t NUMBER>
+    static void gpioTgl()
+    {
+        static_assert(NUMBER < BOARD_GPIOS_COUNT, "Board GPIO number is out of range");
+        constexpr uint32_t LOW_MASK = getGpioLowMask(NUMBER);
+        constexpr uint32_t HIGH_MASK = getGpioHighMask(NUMBER);
+        if(LOW_MASK){
+            if(GPIO.out & LOW_MASK){
+                GPIO.out_w1tc = LOW_MASK;
+            }
+            else{
+                GPIO.out_w1ts = LOW_MASK;
+            }
+        }
+        else if(HIGH_MASK){
+            if(GPIO.out1.val & HIGH_MASK){
+                GPIO.out1_w1tc.val = HIGH_MASK;
+            }
+            else{
+                GPIO.out1_w1ts.val = HIGH_MASK;
+            }
+        }
+    }
+
+    template<uint8_t NUMBER>
+    static bool getGpio()
+    {
+        static_assert(NUMBER < BOARD_GPIOS_COUNT, "Board GPIO number is out of range");
+        constexpr uint32_t LOW_MASK = getGpioLowMask(NUMBER);
+        constexpr uint32_t HIGH_MASK = getGpioHighMask(NUMBER);
+        return LOW_MASK ? ((GPIO.in & LOW_MASK) != 0) : ((GPIO.in1.val & HIGH_MASK) != 0);
+    }
+
+    /// Same as above with masks resolved at compile time
+    template<uint64_t INDICES>
+    static void gpioSetOn()
+    {
+        writeMasks<getLowMask(INDICES), getHighMask(INDICES)>(GPIO.out_w1ts, GPIO.out1_w1ts.val);
+    }
+
+    template<uint64_t INDICES>
+    static void gpioSetOff()
+    {
+        writeMasks<getLowMask(INDICES), getHighMask(INDICES)>(GPIO.out_w1tc, GPIO.out1_w1tc.val);
+    }
+
+    /// Register masks of single board GPIO: pin 0..31 and pin 32..39
+    static constexpr uint32_t getGpioLowMask(uint8_t number)
+    {
+        return ((number < BOARD_GPIOS_COUNT) && (boardGpios_[number].pin != GPIO_NUM_NC) &&
+                (boardGpios_[number].pin < 32)) ? (1U << boardGpios_[number].pin) : 0;
+    }
+
+    static constexpr uint32_t getGpioHighMask(uint8_t number)
+    {
+        return ((number < BOARD_GPIOS_COUNT) && (boardGpios_[number].pin >= 32)) ?
+                (1U << (boardGpios_[number].pin - 32)) : 0;
+    }
+
+    /// Register masks of board GPIOs selected by indices, evaluated at compile time only
+    static constexpr uint32_t getLowMask(uint64_t indices, uint8_t index = 0)
+    {
+        return ((index >= BOARD_GPIOS_COUNT) || (index >= 64)) ? 0 :
+                (((indices >> index) & 1U) ? getGpioLowMask(index) : 0) | getLowMask(indices, index + 1);
+    }
+
+    static constexpr uint32_t getHighMask(uint64_t indices, uint8_t index = 0)
+    {
+        return ((index >= BOARD_GPIOS_COUNT) || (index >= 64)) ? 0 :
+                (((indices >> index) & 1U) ? getGpioHighMask(index) : 0) | getHighMask(indices, index + 1);
+    }
+
+    /// Board GPIO pins must exist and output ones must be output capable
+    static constexpr bool isBoardGpiosValid(uint8_t index = 0)
+    {
+        return (index >= BOARD_GPIOS_COUNT) || (((boardGpios_[index].pin == GPIO_NUM_NC) ||
+                ((boardGpios_[index].pin >= 0) && (boardGpios_[index].pin < 40) &&
+                ((VALID_PINS_MASK >> boardGpios_[index].pin) & 1U) &&
+                ((boardGpios_[index].direction == GPIO_MODE_INPUT) ||
+                (boardGpios_[index].direction == GPIO_MODE_DISABLE) ||
+                ((OUTPUT_PINS_MASK >> boardGpios_[index].pin) & 1U)))) &&
+                isBoardGpiosValid(index + 1));
+    }
+
+    /// Occupied pins are collected in a mask, so recursion depth is number of board GPIOs
+    static constexpr bool isBoardGpiosUnique(uint8_t index = 0, uint64_t pinsMask = 0)
+    {
+        return (index >= BOARD_GPIOS_COUNT) || ((pinsMask & getPinMask(boardGpios_[index].pin)) ? false :
+                isBoardGpiosUnique(index + 1, pinsMask | getPinMask(boardGpios_[index].pin)));
+    }
 
 private:
-	static const BoardGpio_t boardGpios_[];
-	static char* serial_;
+    static constexpr const char* logTag_ = "[ JbController ]";
+    //ESP32 has no GPIO20, GPIO24, GPIO28..31, GPIO34..39 are input only
+    static constexpr uint64_t VALID_PINS_MASK = 0xFFFFFFFFFFULL &
+            ~((1ULL << 20) | (1ULL << 24) | (0xFULL << 28));
+    static constexpr uint64_t OUTPUT_PINS_MASK = VALID_PINS_MASK & ((1ULL << 34) - 1);
+    static Identity_t identity_;
+
+    static void readIdentity();
+    static void initializeGpiosBulk();
+
+    static constexpr bool isOutputGpio(uint8_t index)
+    {
+        return (boardGpios_[index].pin != GPIO_NUM_NC) && (boardGpios_[index].direction != GPIO_MODE_INPUT) &&
+                (boardGpios_[index].direction != GPIO_MODE_DISABLE);
+    }
+
+    /// Register masks of connected board GPIOs with (isOutput) or without output driver
+    static constexpr uint32_t getDirectionLowMask(bool isOutput, uint8_t index = 0)
+    {
+        return (index >= BOARD_GPIOS_COUNT) ? 0 : ((isOutputGpio(index) == isOutput) ? getGpioLowMask(index) : 0) |
+                getDirectionLowMask(isOutput, index + 1);
+    }
+
+    static constexpr uint32_t getDirectionHighMask(bool isOutput, uint8_t index = 0)
+    {
+        return (index >= BOARD_GPIOS_COUNT) ? 0 : ((isOutputGpio(index) == isOutput) ? getGpioHighMask(index) : 0) |
+                getDirectionHighMask(isOutput, index + 1);
+    }
+
+    /// Not connected or wrong pin gives empty mask
+    static constexpr uint64_t getPinMask(gpio_num_t pin)
+    {
+        return ((pin >= 0) && (pin < 64)) ? (1ULL << pin) : 0;
+    }
+
+    template<uint32_t LOW_MASK, uint32_t HIGH_MASK>
+    static inline void writeMasks(volatile uint32_t& lowRegister, volatile uint32_t& highRegister)
+    {
+        if(LOW_MASK){
+            lowRegister = LOW_MASK;
+        }
+        if(HIGH_MASK){
+            highRegister = HIGH_MASK;
+        }
+    }
 };
 
+static_assert(JbController::isBoardGpiosValid(), "JBCONTROLLER_BOARD_GPIOS contains invalid or not output capable pin");
+static_assert(JbController::isBoardGpiosUnique(), "JBCONTROLLER_BOARD_GPIOS contains duplicate pins");
+
 }
 }
 
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief Profiler class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "jbdrivers/ProfilerAggregator.hpp"
+
+namespace jblib {
+    namespace jbdrivers {
+
+        typedef enum{
+            PROFILER_PROBE_UART_EVENT = 0,
+            PROFILER_PROBE_SPI_TRANSACTION,
+            PROFILER_PROBE_GPIO_CALLBACK,
+            PROFILER_PROBE_USER,    //< first probe id free for application
+        }ProfilerProbeId_t;
+
+    }
+}
+
+#if CONFIG_PROFILER_ENABLE
+
+#include "freertos/FreeRTOS.h"
+#include "xtensa/hal.h"
+
+#define JB_PROFILE_CONCAT_(a, b) a##b
+#define JB_PROFILE_CONCAT(a, b) JB_PROFILE_CONCAT_(a, b)
+/// Records duration of enclosing scope, compiles to nothing if profiler is disabled
+#define JB_PROFILE_SCOPE(probeId) \
+        const ::jblib::jbdrivers::ProfilerProbe JB_PROFILE_CONCAT(jbProfilerProbe, __LINE__)(probeId)
+
+namespace jblib {
+    namespace jbdrivers {
+
+        /**
+         * Records begin/end CPU cycle counter pairs into per-core rings. Cycle counters of the cores
+         * aren't synchronized, so a pair is dropped if the task migrated to another core inside the scope.
+         * Rings are drained into ProfilerAggregator by collect() from a low priority task.
+         */
+        class Profiler
+        {
+        public:
+            static constexpr size_t RING_SIZE = CONFIG_PROFILER_RING_SIZE;
+
+            static inline uint32_t getTicks() __attribute__((always_inline))
+            {
+                return xthal_get_ccount();
+            }
+
+            static inline void record(uint16_t probeId, uint32_t beginTicks, int core) __attribute__((always_inline))
+            {
+                const uint32_t endTicks = getTicks();
+                //ring has one producer per core when interrupts are masked
+                const auto state = portSET_INTERRUPT_MASK_FROM_ISR();
+                if(core == xPortGetCoreID()){
+                    rings_[core].push(ProfilerRecord_t{beginTicks, endTicks, probeId});
+                }
+                portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+            }
+
+            /// Returns number of moved records
+            static size_t collect(ProfilerAggregator& aggregator);
+            static uint32_t getDroppedCount();
+
+        private:
+            static ProfilerRing<RING_SIZE> rings_[portNUM_PROCESSORS];
+        };
+
+        class ProfilerProbe
+        {
+        public:
+            explicit inline ProfilerProbe(uint16_t probeId) __attribute__((always_inline)) :
+                    probeId_(probeId), core_(xPortGetCoreID()), beginTicks_(Profiler::getTicks())
+            {
+
+            }
+
+            inline ~ProfilerProbe() __attribute__((always_inline))
+            {
+                Profiler::record(this->probeId_, this->beginTicks_, this->core_);
+            }
+
+            ProfilerProbe(const ProfilerProbe&) = delete;
+            ProfilerProbe& operator=(const ProfilerProbe&) = delete;
+
+        private:
+            const uint16_t probeId_;
+            const int core_;
+            const uint32_t beginTicks_;
+        };
+
+    }
+}
+
+#else
+
+#define JB_PROFILE_SCOPE(probeId)
+
+#endif
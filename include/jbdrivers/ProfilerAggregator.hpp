@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Profiler Aggregator class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include <atomic>
+#include <vector>
+
+namespace jblib {
+    namespace jbdrivers {
+
+        typedef struct {
+            uint32_t beginTicks;
+            uint32_t endTicks;      //< duration is computed modulo 2^32, clock may wrap
+            uint16_t probeId;
+        } ProfilerRecord_t;
+
+        class ProfilerAggregator;
+
+        /**
+         * Lock-free single producer/single consumer ring of probe records.
+         * Producer must not be preempted by another producer of the same ring.
+         */
+        template<size_t SIZE>
+        class ProfilerRing
+        {
+            static_assert((SIZE & (SIZE - 1)) == 0, "Profiler ring size must be a power of 2");
+
+        public:
+            inline bool push(const ProfilerRecord_t& record) __attribute__((always_inline))
+            {
+                const uint32_t head = this->head_.load(std::memory_order_relaxed);
+                if((head - this->tail_.load(std::memory_order_acquire)) >= SIZE){
+                    this->droppedCount_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                this->ring_[head & (SIZE - 1)] = record;
+                this->head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            template<typename Consumer>
+            size_t drain(Consumer& consumer)
+            {
+                const uint32_t head = this->head_.load(std::memory_order_acquire);
+                uint32_t tail = this->tail_.load(std::memory_order_relaxed);
+                const size_t count = head - tail;
+                while(tail != head){
+                    consumer.add(this->ring_[tail & (SIZE - 1)]);
+                    tail++;
+                    this->tail_.store(tail, std::memory_order_release);
+                }
+                return count;
+            }
+
+            uint32_t getDroppedCount() const {return this->droppedCount_.load(std::memory_order_relaxed);}
+
+        private:
+            ProfilerRecord_t ring_[SIZE];
+            std::atomic<uint32_t> head_{0};
+            std::atomic<uint32_t> tail_{0};
+            std::atomic<uint32_t> droppedCount_{0};
+        };
+
+        /**
+         * Per-probe duration statistics, runs off the hot path. Min, max and average cover all
+         * records since reset, 99th percentile is taken over the latest samplesPerProbe durations.
+         * Platform independent, durations are in clock ticks of the recorder.
+         */
+        class ProfilerAggregator
+        {
+        public:
+            typedef struct {
+                uint32_t count = 0;
+                uint32_t min = 0;
+                uint32_t max = 0;
+                uint32_t average = 0;
+                uint32_t p99 = 0;
+            } Statistics_t;
+
+            explicit ProfilerAggregator(uint16_t probesCount, uint16_t samplesPerProbe = 256);
+            void add(const ProfilerRecord_t& record);
+            Statistics_t getStatistics(uint16_t probeId) const;
+            uint16_t getProbesCount() const {return static_cast<uint16_t>(this->probes_.size());}
+            void reset();
+
+        private:
+            struct Probe
+            {
+                uint32_t count;
+                uint32_t min;
+                uint32_t max;
+                uint64_t sum;
+            };
+
+            uint16_t samplesPerProbe_ = 0;
+            std::vector<Probe> probes_;
+            std::vector<uint32_t> samples_;    //< ring of latest durations of every probe
+        };
+
+    }
+}
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * @brief Soft Timer Multiplexer class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "jbdrivers/VoidTimer.hpp"
+#include "jbdrivers/IsrDelegate.hpp"
+#include <atomic>
+#include <thread>
+
+namespace jblib {
+    namespace jbdrivers {
+
+        class SoftTimerMultiplexer;
+
+        class SoftTimer
+        {
+        public:
+            /**
+             * @param callback called on expiration
+             * @param isDeferred false - callback is called in timer ISR, true - in multiplexer task
+             */
+            explicit SoftTimer(const IsrDelegate& callback, void* parameter = nullptr, bool isDeferred = false) :
+                    callback_(callback), parameter_(parameter), isDeferred_(isDeferred) {}
+            SoftTimer(const SoftTimer&) = delete;
+            SoftTimer& operator=(const SoftTimer&) = delete;
+            /// Number of deferred expirations merged because task didn't process previous one
+            uint32_t getOverrunsCount() const {return this->overrunsCount_;}
+
+        private:
+            friend class SoftTimerMultiplexer;
+
+            typedef enum{
+                DISPATCH_NONE = 0,
+                DISPATCH_PENDING,
+                DISPATCH_CANCELLED,     //< still in dispatch stack, skipped on pop
+            }DispatchState_t;
+
+            IsrDelegate callback_;
+            void* parameter_ = nullptr;
+            bool isDeferred_ = false;
+            SoftTimer* next_ = nullptr;
+            SoftTimer* previous_ = nullptr;
+            SoftTimer** list_ = nullptr;    //< wheel slot timer is linked to, nullptr if not in wheel
+            uint8_t level_ = 0;
+            uint8_t slot_ = 0;
+            SoftTimer* dispatchNext_ = nullptr;
+            DispatchState_t dispatchState_ = DISPATCH_NONE;
+            uint64_t expires_ = 0;          //< in wheel quanta
+            uint64_t period_ = 0;           //< in wheel quanta, 0 - one-shot
+            uint32_t overrunsCount_ = 0;
+        };
+
+        /**
+         * Any number of one-shot and periodic software timers on one VoidTimer in one-shot mode.
+         * Timers are kept in a hierarchical timer wheel (4 levels of 64 slots) of intrusive lists,
+         * so start and cancel are O(1). Hardware alarm is set to the nearest wheel event,
+         * there is no periodic tick. Far timers cost additional alarms when they move to lower levels.
+         */
+        class SoftTimerMultiplexer
+        {
+        public:
+            explicit SoftTimerMultiplexer(VoidTimer& timer, bool isDeferredDispatchEnabled = true);
+            ~SoftTimerMultiplexer();
+            SoftTimerMultiplexer(const SoftTimerMultiplexer&) = delete;
+            SoftTimerMultiplexer& operator=(const SoftTimerMultiplexer&) = delete;
+            /// Starts or restarts timer from task or deferred callback, microseconds are converted by flash code
+            void start(SoftTimer& timer, uint64_t delayUs, uint64_t periodUs = 0);
+            /// Only startTicks() and cancel() are in IRAM and can be called from ISR
+            void startTicks(SoftTimer& timer, uint64_t delayTicks, uint64_t periodTicks = 0);
+            void cancel(SoftTimer& timer);
+            bool isActive(const SoftTimer& timer);
+
+        private:
+            static constexpr const char* logTag_ = "[ Soft Timers ]";
+            static constexpr uint32_t RESOLUTION_SHIFT = CONFIG_SOFT_TIMER_RESOLUTION_SHIFT;
+            static constexpr uint32_t LEVELS = 4;
+            static constexpr uint32_t SLOT_BITS = 6;
+            static constexpr uint32_t SLOTS = 1U << SLOT_BITS;
+            static constexpr uint64_t MAX_DELTA = (1ULL << (LEVELS * SLOT_BITS)) - 1;
+
+            VoidTimer& timer_;
+            portMUX_TYPE mutex_;
+            SoftTimer* wheel_[LEVELS][SLOTS] = {};
+            uint64_t occupancy_[LEVELS] = {};
+            SoftTimer* expired_ = nullptr;  //< dispatch stack of timers with callback in ISR
+            SoftTimer* deferred_ = nullptr; //< dispatch stack of timers with callback in task
+            uint64_t now_ = 0;              //< last processed wheel quantum
+            uint64_t alarm_ = UINT64_MAX;   //< quantum hardware alarm is set to
+            uint32_t wheelCount_ = 0;
+            SemaphoreHandle_t deferredSemaphore_ = nullptr;
+            std::atomic<bool> isRunning_{false};
+            std::thread deferredThread_;
+
+            uint64_t getCurrentQuantum();
+            void unlink(SoftTimer& timer);
+            void insert(SoftTimer& timer);
+            void expire(SoftTimer& timer);
+            uint64_t getNextEvent() const;
+            void advance(uint64_t quantum);
+            void updateAlarm();
+            void onAlarm();
+            bool dispatch(SoftTimer*& stack);
+            void deferredDispatcher();
+        };
+
+    }
+}
@@ -28,6 +28,15 @@
 #include "jbkernel/jb_common.h"
 #include "driver/spi_master.h"
 #include <forward_list>
+#include <mutex>
+#if CONFIG_SPI_MASTER_TRACE_ENABLE
+#include "jbdrivers/SpiTrace.hpp"
+#endif
+#if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+#include <atomic>
+#include <thread>
+#include <vector>
+#endif
 
 namespace jblib {
     namespace jbdrivers {
@@ -37,7 +46,20 @@ namespace jblib {
         public:
             class Device;
 
+            typedef enum{
+                DATA_MODE_SINGLE = 0,
+                DATA_MODE_DUAL = 1,    //< half duplex only
+                DATA_MODE_QUAD = 2,    //< half duplex only, uses WP and HD lines
+            }DataMode_t;
+
+            typedef enum{
+                PRIORITY_NORMAL = 0,
+                PRIORITY_HIGH = 1,  //< overtakes normal transactions of all devices on the bus
+                PRIORITY_MAX,
+            }TransactionPriority_t;
+
         private:
+            friend class SpiSamplingPipeline;
 
             static spi_device_handle_t getDeviceHandle(const Device& device)
             {
@@ -54,6 +76,28 @@ namespace jblib {
                 return device.deviceConfiguration_;
             }
 
+            static void setDeviceMaster(Device& device, SpiMaster* master)
+            {
+                device.master_ = master;
+            }
+
+            static SpiMaster* getDeviceMaster(const Device& device)
+            {
+                return device.master_;
+            }
+
+            #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+            static QueueHandle_t* getDeviceQueues(Device& device)
+            {
+                return device.queues_;
+            }
+
+            static std::atomic<uint32_t>& getDeviceSendersCount(Device& device)
+            {
+                return device.sendersCount_;
+            }
+            #endif
+
         public:
             class Device
             {
@@ -61,29 +105,119 @@ namespace jblib {
                 Device(const Device&) = delete;
                 Device& operator=(const Device&) = delete;
                 virtual spi_bus_config_t getBusConfiguration();
+                #if CONFIG_SPI_MASTER_TRACE_ENABLE
+                const SpiDeviceTrace_t& getTrace() const {return this->trace_;}
+                void resetTrace() {this->trace_.reset();}
+                #endif
             protected:
                 Device() = default;
                 virtual ~Device() = default;
+                #if CONFIG_SPI_MASTER_TRACE_ENABLE
+                /// Records time on the wires taken by pre/post callbacks, startUs is used if they didn't run
+                void traceTransaction(const spi_transaction_t& transaction, int64_t startUs);
+                #endif
+                esp_err_t transmit(spi_transaction_t& transaction, bool usePolling,
+                        TransactionPriority_t priority = PRIORITY_NORMAL);
                 spi_device_interface_config_t deviceConfiguration_{};
                 spi_device_handle_t handle = nullptr;
             private:
+                #if CONFIG_SPI_MASTER_TRACE_ENABLE
+                SpiDeviceTrace_t trace_;
+                volatile int64_t busStartUs_ = 0;
+                volatile int64_t busEndUs_ = 0;
+                static void tracePreCallback(spi_transaction_t* transaction);
+                static void tracePostCallback(spi_transaction_t* transaction);
+                friend class SpiMaster;
+                #endif
+                #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+                QueueHandle_t queues_[PRIORITY_MAX]{};
+                std::atomic<uint32_t> sendersCount_{0};    //< callers between queue lookup and pending semaphore give
+                friend QueueHandle_t* SpiMaster::getDeviceQueues(Device& device);
+                friend std::atomic<uint32_t>& SpiMaster::getDeviceSendersCount(Device& device);
+                #endif
+                SpiMaster* master_ = nullptr;
+                friend void SpiMaster::setDeviceMaster(Device& device, SpiMaster* master);
+                friend SpiMaster* SpiMaster::getDeviceMaster(const Device& device);
                 friend spi_device_handle_t SpiMaster::getDeviceHandle(const Device& device);
                 friend void SpiMaster::setDeviceHandle(Device& device, spi_device_handle_t handle);
                 friend spi_device_interface_config_t SpiMaster::getDeviceSpiConfiguration(const Device& device);
             };
 
+            /// Lazy master initializes bus and adds devices on first transaction or start()
             explicit SpiMaster(const spi_bus_config_t& configuration,
-                    spi_host_device_t number = HSPI_HOST, bool useDma = false) noexcept(false);
+                    spi_host_device_t number = HSPI_HOST, bool useDma = false, bool isLazyStart = false) noexcept(false);
             virtual ~SpiMaster();
             SpiMaster(const SpiMaster&) = delete;
             SpiMaster& operator=(const SpiMaster&) = delete;
             void addDevice(Device& device) noexcept(false);
             void removeDevice(const Device& device);
+            void start() noexcept(false);
+            /// Bus on IOMUX native pins of host, required for clock above 26 MHz in full duplex
+            static spi_bus_config_t getIomuxBusConfiguration(spi_host_device_t number,
+                    DataMode_t dataMode = DATA_MODE_SINGLE);
+            /// Max clock of full duplex device for given MISO input delay (slave output delay + PCB)
+            static int getMaxFullDuplexClock(int inputDelayNs, bool useIomux);
+            /// Dummy bits inserted in half duplex read to compensate MISO input delay
+            static int getTimingDummyBits(int clockSpeedHz, int inputDelayNs, bool useIomux);
+            #if CONFIG_SPI_MASTER_TRACE_ENABLE
+            const SpiBusTrace_t& getTrace() const {return this->trace_;}
+            void resetTrace() {this->trace_.reset();}
+            #endif
+            #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+            /**
+             * Starts bus dispatcher: every device gets its own transaction queue per priority,
+             * queues are served round-robin, high priority queues first.
+             * Must be called before devices are added.
+             */
+            void startScheduler();
+            #endif
 
         private:
             static constexpr const char* logTag_ = "[ Spi Master ]";
+            static constexpr int IOMUX_PINS[][6] = {   //< MOSI, MISO, CLK, CS, WP, HD
+                    {-1, -1, -1, -1, -1, -1},   //SPI1 is used by flash
+                    {13, 12, 14, 15, 2, 4},     //HSPI
+                    {23, 19, 18, 5, 22, 21},    //VSPI
+            };
+            static constexpr int IOMUX_HOSTS_COUNT = sizeof(IOMUX_PINS) / sizeof(IOMUX_PINS[0]);
             spi_host_device_t number_ = HSPI_HOST;
+            bool isIomux_ = false;
             std::forward_list<spi_device_handle_t> devicesList_;
+            spi_bus_config_t busConfiguration_{};
+            bool useDma_ = false;
+            bool isStarted_ = false;
+            std::mutex startMutex_;
+            std::forward_list<Device*> pendingDevices_;   //< added before lazy start
+
+            void addStartedDevice(Device& device) noexcept(false);
+            #if CONFIG_SPI_MASTER_TRACE_ENABLE
+            SpiBusTrace_t trace_;
+            #endif
+            #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+            struct ScheduledTransaction
+            {
+                spi_transaction_t* transaction;
+                bool usePolling;
+                esp_err_t* result;
+                SemaphoreHandle_t doneSemaphore;
+            };
+
+            std::vector<Device*> scheduledDevices_;
+            size_t nextDeviceIndex_[PRIORITY_MAX]{};
+            std::mutex schedulerMutex_;    //< guards devices list and queue handles
+            std::mutex dispatchMutex_;     //< held by dispatcher while transaction is taken and transmitted
+            std::thread schedulerThread_;
+            SemaphoreHandle_t pendingSemaphore_ = nullptr;
+            std::atomic<bool> isSchedulerRunning_{false};
+
+            /// Returns ESP_ERR_NOT_FOUND if device has no scheduler queues
+            esp_err_t scheduleTransaction(Device& device, spi_transaction_t& transaction,
+                    bool usePolling, TransactionPriority_t priority);
+            /// Detaches device queues, completes queued transactions with ESP_ERR_INVALID_STATE and deletes queues
+            void releaseDeviceQueues(Device& device);
+            bool takeScheduledTransaction(ScheduledTransaction& scheduledTransaction, Device*& device);
+            void dispatcher();
+            #endif
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,267 @@
+/**
+ * @file
+ * @brief SPI Register Device template definition
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "jbdrivers/SpiMaster.hpp"
+#include "esp_intr_alloc.h"
+#include <type_traits>
+
+namespace jblib {
+    namespace jbdrivers {
+
+        static constexpr uint16_t MAX_WRITE_CHECKS = 8;
+
+        typedef enum{
+            SPI_RW_BIT_WRITE_HIGH = 0, //< R/W bit of command is 1 for write, 0 for read
+            SPI_RW_BIT_READ_HIGH = 1,  //< R/W bit of command is 1 for read, 0 for write
+        }SpiRwBitPolarity_t;
+
+        typedef enum{
+            SPI_BURST_AUTO_INCREMENT = 0, //< device increments address after every data byte
+            SPI_BURST_FLAG_INCREMENT = 1, //< device increments address only if burst flag is set in command
+            SPI_BURST_NOT_SUPPORTED = 2,  //< every register is accessed by a separate transaction
+        }SpiBurstMode_t;
+
+        /**
+         * Register map device: command phase carries R/W bit (MSB of command) and optional burst flag,
+         * address phase carries register address, data phase carries register values.
+         * All framing is resolved at compile time, so register access has no virtual calls.
+         */
+        template<uint8_t COMMAND_BITS, uint8_t ADDRESS_BITS, SpiRwBitPolarity_t RW_POLARITY,
+                SpiBurstMode_t BURST_MODE = SPI_BURST_AUTO_INCREMENT, uint16_t BURST_FLAG = 0>
+        class SpiRegisterDevice : public SpiMaster::Device
+        {
+            static_assert((COMMAND_BITS >= 1) && (COMMAND_BITS <= 16), "Command bits must be in range 1..16");
+            static_assert((ADDRESS_BITS >= 1) && (ADDRESS_BITS <= 32), "Address bits must be in range 1..32");
+            static_assert((BURST_MODE != SPI_BURST_FLAG_INCREMENT) || (BURST_FLAG != 0),
+                    "Burst flag must be set for flag increment burst mode");
+            static_assert((BURST_FLAG >> (COMMAND_BITS - 1)) == 0, "Burst flag overlaps R/W bit of command");
+
+        public:
+            typedef typename std::conditional<(ADDRESS_BITS <= 8), uint8_t,
+                    typename std::conditional<(ADDRESS_BITS <= 16), uint16_t, uint32_t>::type>::type Address_t;
+
+            static constexpr uint16_t RW_BIT = 1U << (COMMAND_BITS - 1);
+            static constexpr uint16_t READ_COMMAND = (RW_POLARITY == SPI_RW_BIT_READ_HIGH) ? RW_BIT : 0;
+            static constexpr uint16_t WRITE_COMMAND = (RW_POLARITY == SPI_RW_BIT_READ_HIGH) ? 0 : RW_BIT;
+            static constexpr uint16_t BURST_COMMAND = (BURST_MODE == SPI_BURST_FLAG_INCREMENT) ? BURST_FLAG : 0;
+
+            struct Configuration
+            {
+                int misoPin = -1;
+                int mosiPin = -1;
+                int clkPin = -1;
+                int csPin = -1;
+                int quadWpPin = -1;
+                int quadHdPin = -1;
+                uint32_t intrFlags = ESP_INTR_FLAG_LOWMED; //priority
+                int clockSpeedHz = SPI_MASTER_FREQ_8M;
+                uint8_t mode = 0; //CPOL, CPHA
+                bool useInterruptMode  = false;
+                uint16_t maxWriteChecks = MAX_WRITE_CHECKS;
+                SpiMaster::DataMode_t dataMode = SpiMaster::DATA_MODE_SINGLE; //dual and quad modes force half duplex
+                bool isMultiLineAddress = false;    //send command and address in dual/quad mode too
+                bool isHalfDuplex = false;          //write doesn't return old value in half duplex
+                int inputDelayNs = 0;               //measured MISO delay, IDF adds dummy bits in half duplex
+                uint8_t dummyBits = 0;              //dummy bits required by device between address and data
+            };
+
+            explicit SpiRegisterDevice(const Configuration& config) : SpiMaster::Device(), config_(config)
+            {
+                this->deviceConfiguration_.command_bits = COMMAND_BITS;
+                this->deviceConfiguration_.address_bits = ADDRESS_BITS;
+                this->deviceConfiguration_.dummy_bits = this->config_.dummyBits;
+                this->deviceConfiguration_.mode = this->config_.mode;
+                this->deviceConfiguration_.duty_cycle_pos = 0;
+                this->deviceConfiguration_.cs_ena_pretrans = 0;
+                this->deviceConfiguration_.cs_ena_posttrans = 0;
+                this->deviceConfiguration_.clock_speed_hz = this->config_.clockSpeedHz;
+                this->deviceConfiguration_.input_delay_ns = this->config_.inputDelayNs;
+                this->deviceConfiguration_.spics_io_num = this->config_.csPin;
+                if(this->config_.dataMode != SpiMaster::DATA_MODE_SINGLE){
+                    this->config_.isHalfDuplex = true;
+                }
+                this->deviceConfiguration_.flags = this->config_.isHalfDuplex ? SPI_DEVICE_HALFDUPLEX : 0;
+                if(this->config_.dataMode == SpiMaster::DATA_MODE_DUAL){
+                    this->transactionFlags_ = SPI_TRANS_MODE_DIO;
+                }
+                else if(this->config_.dataMode == SpiMaster::DATA_MODE_QUAD){
+                    this->transactionFlags_ = SPI_TRANS_MODE_QIO;
+                }
+                if(this->transactionFlags_ && this->config_.isMultiLineAddress){
+                    this->transactionFlags_ |= SPI_TRANS_MODE_DIOQIO_ADDR;
+                }
+                this->deviceConfiguration_.queue_size = 1;
+                this->deviceConfiguration_.pre_cb = nullptr;
+                this->deviceConfiguration_.post_cb = nullptr;
+            }
+
+            ~SpiRegisterDevice() override = default;
+
+            spi_bus_config_t getBusConfiguration() override
+            {
+                auto configuration = SpiMaster::Device::getBusConfiguration();
+                configuration.mosi_io_num = this->config_.mosiPin;
+                configuration.miso_io_num = this->config_.misoPin;
+                configuration.sclk_io_num = this->config_.clkPin;
+                configuration.quadwp_io_num = this->config_.quadWpPin;
+                configuration.quadhd_io_num = this->config_.quadHdPin;
+                if(this->config_.dataMode == SpiMaster::DATA_MODE_DUAL){
+                    configuration.flags |= SPICOMMON_BUSFLAG_DUAL;
+                }
+                else if(this->config_.dataMode == SpiMaster::DATA_MODE_QUAD){
+                    configuration.flags |= SPICOMMON_BUSFLAG_QUAD;
+                }
+                configuration.intr_flags = this->config_.intrFlags;
+                return configuration;
+            }
+
+            uint8_t read(Address_t address, SpiMaster::TransactionPriority_t priority = SpiMaster::PRIORITY_NORMAL)
+            {
+                spi_transaction_t transaction{};
+                transaction.flags = this->getDataFlags(SPI_TRANS_USE_RXDATA) | this->transactionFlags_;
+                transaction.cmd = READ_COMMAND;
+                transaction.addr = address;
+                this->setReadLength(transaction, 1);
+                esp_err_t ret = this->makeTransaction(transaction, priority);
+                if(ret != ESP_OK){
+                    ESP_LOGE(logTag_, "Transaction error %i", ret);
+                }
+                return transaction.rx_data[0];
+            }
+
+            void read(Address_t startAddress, const uint8_t* data, size_t size,
+                    SpiMaster::TransactionPriority_t priority = SpiMaster::PRIORITY_NORMAL)
+            {
+                if(BURST_MODE == SPI_BURST_NOT_SUPPORTED){
+                    auto buffer = const_cast<uint8_t*>(data);
+                    for(size_t i = 0; i < size; i++){
+                        buffer[i] = this->read(static_cast<Address_t>(startAddress + i), priority);
+                    }
+                    return;
+                }
+                spi_transaction_t transaction{};
+                transaction.flags = this->transactionFlags_;
+                transaction.cmd = READ_COMMAND | BURST_COMMAND;
+                transaction.addr = startAddress;
+                this->setReadLength(transaction, size);
+                transaction.tx_buffer = nullptr;
+                transaction.rx_buffer = const_cast<uint8_t*>(data);
+                esp_err_t ret = this->makeTransaction(transaction, priority);
+                if(ret != ESP_OK){
+                    ESP_LOGE(logTag_, "Transaction error %i", ret);
+                }
+            }
+
+            uint8_t write(Address_t address, uint8_t data, bool waitUntilSet = false,  //returns old value of register, 0 in half duplex
+                    SpiMaster::TransactionPriority_t priority = SpiMaster::PRIORITY_NORMAL)
+            {
+                spi_transaction_t transaction{};
+                transaction.flags = this->getDataFlags(SPI_TRANS_USE_TXDATA) | this->transactionFlags_;
+                transaction.cmd = WRITE_COMMAND;
+                transaction.addr = address;
+                transaction.length = 8; //< Total data length, in bits
+                transaction.tx_data[0] = data;
+                esp_err_t ret = this->makeTransaction(transaction, priority);
+                if(ret != ESP_OK){
+                    ESP_LOGE(logTag_, "Transaction error %i", ret);
+                }
+                if(waitUntilSet){
+                    ret = this->makeTransaction(transaction, priority);
+                    if(ret != ESP_OK){
+                        ESP_LOGE(logTag_, "Transaction error %i", ret);
+                    }
+                    for(size_t i = 0; i < this->config_.maxWriteChecks; i++){
+                        if(this->read(address, priority) == data){
+                            break;
+                        }
+                    }
+                }
+                return transaction.rx_data[0];
+            }
+
+            void write(Address_t startAddress, const uint8_t* data, size_t size, //max value size is 4096 if using DMA, 64 if not
+                    SpiMaster::TransactionPriority_t priority = SpiMaster::PRIORITY_NORMAL)
+            {
+                if(BURST_MODE == SPI_BURST_NOT_SUPPORTED){
+                    for(size_t i = 0; i < size; i++){
+                        this->write(static_cast<Address_t>(startAddress + i), data[i], false, priority);
+                    }
+                    return;
+                }
+                spi_transaction_t transaction{};
+                transaction.flags = this->transactionFlags_;
+                transaction.cmd = WRITE_COMMAND | BURST_COMMAND;
+                transaction.addr = startAddress;
+                transaction.length = 8 * size;  //< Total data length, in bits
+                transaction.tx_buffer = data;
+                esp_err_t ret = this->makeTransaction(transaction, priority);
+                if(ret != ESP_OK){
+                    ESP_LOGE(logTag_, "Transaction error %i", ret);
+                }
+            }
+
+        protected:
+            Configuration config_;
+            uint32_t transactionFlags_ = 0;
+
+            /// In half duplex only the used data phase may be enabled, zero length phase is rejected by IDF
+            uint32_t getDataFlags(uint32_t halfDuplexFlag) const
+            {
+                return this->config_.isHalfDuplex ? halfDuplexFlag : (SPI_TRANS_USE_RXDATA | SPI_TRANS_USE_TXDATA);
+            }
+
+            void setReadLength(spi_transaction_t& transaction, size_t size) const
+            {
+                if(this->config_.isHalfDuplex){
+                    transaction.length = 0;
+                    transaction.rxlength = 8 * size;  //< Total received data length, in bits
+                }
+                else{
+                    transaction.length = 8 * size;  //< Total data length, in bits
+                }
+            }
+
+            esp_err_t makeTransaction(spi_transaction_t& transaction,
+                    SpiMaster::TransactionPriority_t priority = SpiMaster::PRIORITY_NORMAL)
+            {
+                #if CONFIG_SPI_MASTER_TRACE_ENABLE
+                const int64_t startUs = esp_timer_get_time();
+                #endif
+                esp_err_t ret = this->transmit(transaction, !this->config_.useInterruptMode, priority);
+                #if CONFIG_SPI_MASTER_TRACE_ENABLE
+                this->traceTransaction(transaction, startUs);
+                #endif
+                return ret;
+            }
+
+        private:
+            static constexpr const char* logTag_ = "[ Spi Reg Dev ]";
+        };
+
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief SPI Sampling Pipeline class definition
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "jbdrivers/SpiMaster.hpp"
+#include "jbdrivers/VoidTimer.hpp"
+#include "soc/spi_struct.h"
+#include <atomic>
+#include <memory>
+
+namespace jblib {
+    namespace jbdrivers {
+
+        /**
+         * Fixed rate sampling of SPI device without task scheduling on sample path.
+         * Pipeline acquires the bus, programs SPI registers by one polling transaction and then
+         * timer ISR restarts the same transaction by hardware, so samples are taken with timer accuracy.
+         * Result of transaction is collected on the next tick. Samples are packed into blocks of a
+         * lock-free single producer/single consumer ring, consumer is woken once per block.
+         * Transaction must fit SPI data buffer (64 bytes), master must not use DMA and device must not be used
+         * while pipeline runs.
+         */
+        class SpiSamplingPipeline
+        {
+        public:
+            struct Configuration
+            {
+                uint32_t periodUs = 1000;
+                uint16_t sampleSize = 2;        //< bytes of received data stored per sample
+                uint16_t samplesPerBlock = 64;
+                uint8_t blocksCount = 2;        //< power of 2, 2 is double buffering
+            };
+
+            typedef struct {
+                uint64_t samplesCount = 0;      //< timer ticks since start
+                uint32_t overrunsCount = 0;     //< ticks skipped because transaction was still running
+                uint32_t droppedSamplesCount = 0;   //< samples lost because consumer didn't release blocks
+            } Statistics_t;
+
+            SpiSamplingPipeline(SpiMaster::Device& device, VoidTimer& timer, const Configuration& config) noexcept(false);
+            ~SpiSamplingPipeline();
+            SpiSamplingPipeline(const SpiSamplingPipeline&) = delete;
+            SpiSamplingPipeline& operator=(const SpiSamplingPipeline&) = delete;
+            /// Transaction is copied, it must use SPI_TRANS_USE_TXDATA/RXDATA or buffers up to 64 bytes
+            void start(const spi_transaction_t& transaction);
+            void stop();
+            /**
+             * Waits for the oldest filled block. Returns nullptr on timeout.
+             * firstSampleNumber is number of the first sample of the block since start, sample time is
+             * number * periodUs. Block stays valid until releaseBlock().
+             */
+            const uint8_t* acquireBlock(TickType_t ticksToWait = portMAX_DELAY, uint64_t* firstSampleNumber = nullptr);
+            void releaseBlock();
+            size_t getBlockSize() const {return static_cast<size_t>(this->config_.sampleSize) * this->config_.samplesPerBlock;}
+            Statistics_t getStatistics();
+
+        private:
+            static constexpr const char* logTag_ = "[ Spi Sampling ]";
+            static constexpr size_t DATA_WORDS = 16;
+            SpiMaster::Device& device_;
+            VoidTimer& timer_;
+            Configuration config_;
+            spi_dev_t* hw_ = nullptr;
+            spi_transaction_t transaction_{};
+            uint32_t txWords_[DATA_WORDS] = {};
+            uint32_t rxWords_[DATA_WORDS] = {};   //< receive buffer of register programming transaction
+            size_t txWordsCount_ = 0;
+            std::unique_ptr<uint8_t[]> blocks_;
+            std::unique_ptr<uint64_t[]> firstSamples_;
+            std::atomic<uint32_t> writeBlock_{0};   //< advanced by ISR when block is filled
+            std::atomic<uint32_t> readBlock_{0};    //< advanced by consumer on release
+            uint32_t sampleIndex_ = 0;              //< in the block being filled
+            bool isTransactionPending_ = false;
+            uint64_t pendingSampleNumber_ = 0;    //< tick on which pending transaction was started
+            bool isRunning_ = false;
+            SemaphoreHandle_t blockSemaphore_ = nullptr;
+            portMUX_TYPE mutex_;
+            Statistics_t statistics_;
+
+            void onTick();
+            bool storeSample(uint64_t sampleNumber);
+        };
+
+    }
+}
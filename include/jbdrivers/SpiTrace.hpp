@@ -0,0 +1,181 @@
+/**
+ * @file
+ * @brief SPI Trace class definition
+ *
+ *
+ * @note
+ * Copyright © 2020 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+#pragma once
+
+#include "jbkernel/jb_common.h"
+#include "esp_timer.h"
+#include <atomic>
+
+#if CONFIG_SPI_MASTER_TRACE_ENABLE
+
+namespace jblib {
+    namespace jbdrivers {
+
+        typedef struct {
+            uint32_t transactionsCount = 0;
+            uint32_t bytesCount = 0;
+            uint64_t busyTimeUs = 0;
+        } SpiTraceCounters_t;
+
+        typedef struct {
+            int64_t timestampUs = 0;    //< transaction start time
+            uint32_t durationUs = 0;
+            uint32_t address = 0;
+            uint16_t command = 0;
+            uint16_t bytesCount = 0;
+        } SpiTraceRecord_t;
+
+        /**
+         * Transaction counters (total and per register address) and a ring of recent transactions.
+         * Counters are updated under spinlock, the ring is written lock-free: every slot is
+         * guarded by its own sequence number, so readers skip slots that are being overwritten.
+         * Addresses starting from ADDRESSES_COUNT - 1 are accumulated in the last address counter.
+         */
+        template<size_t ADDRESSES_COUNT>
+        class SpiTrace
+        {
+            static constexpr uint32_t RING_SIZE = CONFIG_SPI_MASTER_TRACE_RING_SIZE;
+            static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "Trace ring size must be a power of 2");
+            static_assert(ADDRESSES_COUNT > 0, "At least one address counter is required");
+
+        public:
+            SpiTrace()
+            {
+                vPortCPUInitializeMutex(&this->mutex_);
+                this->resetTimeUs_ = esp_timer_get_time();
+            }
+
+            SpiTrace(const SpiTrace&) = delete;
+            SpiTrace& operator=(const SpiTrace&) = delete;
+
+            void record(uint32_t address, uint16_t command, size_t bytesCount, int64_t startUs, int64_t endUs)
+            {
+                const auto durationUs = static_cast<uint32_t>(endUs - startUs);
+                const size_t addressIndex = (address < ADDRESSES_COUNT) ? address : (ADDRESSES_COUNT - 1);
+                portENTER_CRITICAL(&this->mutex_);
+                this->total_.transactionsCount++;
+                this->total_.bytesCount += bytesCount;
+                this->total_.busyTimeUs += durationUs;
+                this->addresses_[addressIndex].transactionsCount++;
+                this->addresses_[addressIndex].bytesCount += bytesCount;
+                this->addresses_[addressIndex].busyTimeUs += durationUs;
+                portEXIT_CRITICAL(&this->mutex_);
+
+                const uint32_t index = this->ringHead_.fetch_add(1, std::memory_order_relaxed);
+                auto& slot = this->ring_[index & (RING_SIZE - 1)];
+                slot.sequence.store(0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.record.timestampUs = startUs;
+                slot.record.durationUs = durationUs;
+                slot.record.address = address;
+                slot.record.command = command;
+                slot.record.bytesCount = static_cast<uint16_t>(bytesCount);
+                slot.sequence.store(index + 1, std::memory_order_release);
+            }
+
+            SpiTraceCounters_t getCounters() const
+            {
+                portENTER_CRITICAL(&this->mutex_);
+                auto counters = this->total_;
+                portEXIT_CRITICAL(&this->mutex_);
+                return counters;
+            }
+
+            SpiTraceCounters_t getAddressCounters(uint32_t address) const
+            {
+                const size_t addressIndex = (address < ADDRESSES_COUNT) ? address : (ADDRESSES_COUNT - 1);
+                portENTER_CRITICAL(&this->mutex_);
+                auto counters = this->addresses_[addressIndex];
+                portEXIT_CRITICAL(&this->mutex_);
+                return counters;
+            }
+
+            /// Copies up to maxCount most recent records, newest first. Returns number of copied records.
+            size_t getRecentTransactions(SpiTraceRecord_t* records, size_t maxCount) const
+            {
+                const uint32_t head = this->ringHead_.load(std::memory_order_acquire);
+                size_t count = 0;
+                for(uint32_t i = 0; (i < RING_SIZE) && (i < head) && (count < maxCount); i++){
+                    const uint32_t index = head - 1 - i;
+                    const auto& slot = this->ring_[index & (RING_SIZE - 1)];
+                    if(slot.sequence.load(std::memory_order_acquire) != index + 1){
+                        continue;
+                    }
+                    records[count] = slot.record;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if(slot.sequence.load(std::memory_order_relaxed) == index + 1){
+                        count++;
+                    }
+                }
+                return count;
+            }
+
+            /// Percentage of time spent in transactions since construction or last reset
+            float getUtilisation() const
+            {
+                portENTER_CRITICAL(&this->mutex_);
+                const int64_t elapsedUs = esp_timer_get_time() - this->resetTimeUs_;
+                const uint64_t busyTimeUs = this->total_.busyTimeUs;
+                portEXIT_CRITICAL(&this->mutex_);
+                if(elapsedUs <= 0){
+                    return 0;
+                }
+                return (100.0f * static_cast<float>(busyTimeUs)) / static_cast<float>(elapsedUs);
+            }
+
+            void reset()
+            {
+                portENTER_CRITICAL(&this->mutex_);
+                this->total_ = {};
+                for(auto& counters : this->addresses_){
+                    counters = {};
+                }
+                this->resetTimeUs_ = esp_timer_get_time();
+                portEXIT_CRITICAL(&this->mutex_);
+            }
+
+        private:
+            struct Slot
+            {
+                std::atomic<uint32_t> sequence{0};
+                SpiTraceRecord_t record;
+            };
+
+            mutable portMUX_TYPE mutex_;
+            int64_t resetTimeUs_ = 0;
+            SpiTraceCounters_t total_;
+            SpiTraceCounters_t addresses_[ADDRESSES_COUNT];
+            std::atomic<uint32_t> ringHead_{0};
+            Slot ring_[RING_SIZE];
+        };
+
+        typedef SpiTrace<CONFIG_SPI_MASTER_TRACE_ADDRESSES> SpiDeviceTrace_t;
+        typedef SpiTrace<1> SpiBusTrace_t;
+
+    }
+}
+
+#endif
@@ -26,40 +26,17 @@
 #pragma once
 
 #include "jbkernel/jb_common.h"
-#include "jbdrivers/SpiMaster.hpp"
-#include "esp_intr_alloc.h"
+#include "jbdrivers/SpiRegisterDevice.hpp"
 
 namespace jblib {
     namespace jbdrivers {
 
-        static constexpr uint16_t MAX_WRITE_CHECKS = 8;
-        class Sx127xSpiDevice : public SpiMaster::Device
+        /// SX127x framing: 1 bit command (1 - write, 0 - read), 7 bit address, address auto increment in burst
+        class Sx127xSpiDevice : public SpiRegisterDevice<1, 7, SPI_RW_BIT_WRITE_HIGH, SPI_BURST_AUTO_INCREMENT>
         {
         public:
-            struct Configuration
-            {
-                int misoPin = -1;
-                int mosiPin = -1;
-                int clkPin = -1;
-                int csPin = -1;
-                uint32_t intrFlags = ESP_INTR_FLAG_LOWMED; //priority
-                int clockSpeedHz = SPI_MASTER_FREQ_8M;
-                bool useInterruptMode  = false;
-                uint16_t maxWriteChecks = MAX_WRITE_CHECKS;
-            };
-
             explicit Sx127xSpiDevice(const Configuration& config);
             ~Sx127xSpiDevice() override = default;
-            spi_bus_config_t getBusConfiguration() final;
-            uint8_t read(uint8_t address);
-            void read(uint8_t address, const uint8_t *data, size_t dataCount);
-            uint8_t write(uint8_t address, uint8_t data, bool waitUntilSet = false); //returns old value of register
-            void write(uint8_t startAddress, const uint8_t* data, size_t size); //max value size is 4096 if using DMA, 64 if not
-
-        private:
-            static constexpr const char* logTag_ = "[ SX127x Spi Dev ]";
-            Configuration config_;
-            esp_err_t makeTransaction(spi_transaction_t& transaction);
         };
 
     }
@@ -30,6 +30,7 @@
 #include "jbkernel/IVoidChannel.hpp"
 #include "jbkernel/JbKernel.hpp"
 #include "driver/uart.h"
+#include <atomic>
 #include <condition_variable>
 
 namespace jblib
@@ -51,12 +52,34 @@ namespace jblib
         {
             static constexpr const char* logTag_ = "[ UART Void Channel ]";
             QueueHandle_t uartEventQueue_ = nullptr;
-            bool isInitialized_ = false;
+            std::atomic<bool> isInitialized_{false};    //< set under startMutex_, read by tx() without it
+            std::atomic<bool> isStartPending_{false};
+            std::mutex startMutex_;
             std::mutex threadExitCvMutex_;
             std::condition_variable threadExitCv_;
             UartVoidChannelStats_t stats_;
 
+            /// First byte time of FIFO contents, bytesOffset counts all bytes received by ISR
+            typedef struct {
+                uint32_t bytesOffset;
+                int64_t timeUs;
+            } RxMark_t;
+
+            static constexpr uint32_t RX_MARKS_RING_SIZE = 16;
+            intr_handle_t rxTimestampHandle_ = nullptr;
+            uint32_t byteTimeNs_ = 0;
+            RxMark_t rxMarks_[RX_MARKS_RING_SIZE] = {};
+            std::atomic<uint32_t> rxMarksHead_{0};
+            std::atomic<uint32_t> rxMarksTail_{0};
+            std::atomic<uint32_t> isrBytesCount_{0};
+            uint32_t deliveredBytesCount_ = 0;
+            int64_t rxTimestampUs_ = 0;
+            mutable portMUX_TYPE rxTimestampMutex_;   //< 64-bit time can tear if read while event thread writes it
+
             void eventHandler();
+            static void rxTimestampIsrHandler(void* arg);
+            int64_t getChunkTimestamp(size_t length);
+            void resetRxTimestamps();
 
         public:
 
@@ -74,14 +97,28 @@ namespace jblib
                 bool swFlowControl = false;
                 uint32_t baudRate = 115200;
                 int interruptAllocFlags = ESP_INTR_FLAG_LOWMED;
+                /**
+                 * Latch esp_timer time in UART interrupt and deliver arrival time of the first byte of every
+                 * received chunk: connectionParameter of rx callback points to int64_t time in us.
+                 * Time is corrected by FIFO level, baud rate and RX timeout. Makes UART interrupt shared.
+                 */
+                bool useRxTimestamps = false;
+                /**
+                 * initialize() only stores parameters, driver is started by first tx() or start().
+                 * Nothing is received before that, so RX-only channel must call start()
+                 */
+                bool isLazyStart = false;
             }Parameters_t;
 
             explicit UartVoidChannel(Parameters_t& parameters);
             ~UartVoidChannel() override;
             void initialize() override ;
+            void start();
             void tx(uint8_t* data, uint16_t size, void* connectionParameter) override ;
 
             UartVoidChannelStats_t* getStatistics();
+            /// Arrival time of the first byte of the last received chunk, 0 if timestamps are off
+            int64_t getLastRxTimestampUs() const;
             void resetStatistics();
 
         protected:
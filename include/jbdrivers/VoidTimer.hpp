@@ -28,7 +28,9 @@
 #include "jbkernel/jb_common.h"
 #include "jbkernel/callback_interfaces.hpp"
 #include "jbkernel/IVoidTimer.hpp"
+#include "jbdrivers/IsrDelegate.hpp"
 #include "driver/timer.h"
+#include <memory>
 
 
 namespace jblib{
@@ -44,7 +46,17 @@ namespace jblib{
                 TIMER_MAX,
             }TimerNum_t;
 
+            typedef struct {
+                uint32_t alarmsCount = 0;
+                uint32_t minLatencyTicks = UINT32_MAX; //< ticks from alarm to ISR entry
+                uint32_t maxLatencyTicks = 0;
+                uint64_t latencySumTicks = 0;
+            } JitterStatistics_t;
+
+            /// Timers live in static storage, acquisition never allocates and is safe from any core
             static VoidTimer& getVoidTimer(TimerNum_t number, int intrFlags = ESP_INTR_FLAG_LOWMED) noexcept(false);
+            static esp_err_t getVoidTimer(TimerNum_t number, VoidTimer*& timer,
+                    int intrFlags = ESP_INTR_FLAG_LOWMED) noexcept;
             VoidTimer(const VoidTimer&) = delete;
             VoidTimer& operator=(const VoidTimer&) = delete;
             void initialize(uint32_t periodUs) override;
@@ -60,18 +72,87 @@ namespace jblib{
             void changePeriod(uint32_t periodUs) override;
             void changePeriodTicks(uint32_t periodTicks) override;
 
+            /// Allocation-free callback, called instead of addCallback() one if set. See IsrDelegate for IRAM use
+            void addIsrCallback(const IsrDelegate& callback, void* parameter = nullptr);
+            void deleteIsrCallback();
+            /// Pauses counter from ISR, including timer's own callback, start() resumes it
+            void stopFromIsr();
+
+            /**
+             * Jitter measurement mode: ISR reads hardware counter at entry, which is the latency since
+             * hardware reload, and keeps statistics and a ring of actual alarm timestamps.
+             */
+            void enableJitterMeasurement(bool isEnabled);
+            JitterStatistics_t getJitterStatistics();
+            /// Copies up to maxCount latest alarm timestamps in ticks since measurement start, newest first
+            size_t getAlarmTimestamps(uint64_t* timestamps, size_t maxCount);
+            void resetJitterStatistics();
+
+            /**
+             * 64-bit API, counter doesn't wrap in practice. Conversions use instance divider,
+             * so nanosecond values are exact to one tick (25 ns at minimal divider 2, 40 MHz from 80 MHz APB).
+             */
+            void initializeTicks64(uint64_t periodTicks);
+            /// Free running counter without auto-reload, alarms are set by deadline
+            void initializeOneShot();
+            uint64_t getCounter64();
+            void setCounter64(uint64_t ticks);
+            uint64_t getNsecCounter();
+            void changePeriodTicks64(uint64_t periodTicks);
+            void changePeriodNs(uint64_t periodNs);
+            /// Divider of 80 MHz APB clock in range 2..65536, applied on next initialize
+            void setDivider(uint32_t divider);
+            uint32_t getDivider() const {return this->divider_;}
+            uint32_t getTickFrequency() const {return TIMER_BASE_CLK / this->divider_;}
+            uint64_t ticksToNs(uint64_t ticks) const;
+            uint64_t nsToTicks(uint64_t ns) const;
+
+            /**
+             * Deadline mode, requires initializeOneShot(). Callback is called once when counter reaches
+             * the deadline, or as soon as possible if deadline has already passed. Rearming replaces
+             * previous deadline. Callable from ISR, including timer's own callback, so it never throws:
+             * in periodic mode error is logged and call is ignored.
+             */
+            void armAt(uint64_t ticks);
+            void armAtNs(uint64_t ns);
+            void armAfter(uint64_t ticks);
+            /// Safe against ISR: callback isn't called after true is returned, false if alarm has fired or wasn't armed
+            bool cancelAlarm();
+            bool isArmed() const {return this->isArmed_;}
+
+            /// Ticks per microsecond with default divider
             static uint32_t getUsTicks() {return US_TICKS;}
 
         private:
             static constexpr const char* logTag_ = "[ VoidTimer ]";
             static constexpr uint32_t DIVIDER = 2;
             static constexpr uint32_t US_TICKS = TIMER_BASE_CLK / DIVIDER / 1000000;
+            static constexpr uint32_t ALARMS_RING_SIZE = CONFIG_VOID_TIMER_ALARMS_RING_SIZE;
+            static_assert((ALARMS_RING_SIZE & (ALARMS_RING_SIZE - 1)) == 0, "Alarms ring size must be a power of 2");
+
+            friend class SoftTimerMultiplexer;
 
-            static bool isrHandler(void* instance);
+            static void isrHandler(void* instance);
+            void measureJitter();
+            void setAlarm64(uint64_t ticks);
+            void initializeTimer(uint64_t periodTicks, bool isOneShot);
             explicit VoidTimer(TimerNum_t number, int intrFlags);
             timer_group_t timerGroup_ = TIMER_GROUP_0;
             timer_idx_t timerIdx_ = TIMER_0;
             int intrFlags_ = 0;
+            IsrDelegate isrCallback_;
+            timer_isr_handle_t isrHandle_ = nullptr;
+            uint64_t periodTicks_ = 0;
+            uint32_t divider_ = DIVIDER;
+            bool isOneShot_ = false;
+            volatile bool isArmed_ = false;
+            uint32_t minAlarmTicks_ = 2;
+            portMUX_TYPE alarmMutex_;     //< guards one-shot state and ISR callback copy
+            portMUX_TYPE jitterMutex_;
+            bool isJitterMeasurementEnabled_ = false;
+            JitterStatistics_t jitterStatistics_;
+            uint64_t alarmBaseTicks_ = 0;  //< time of the latest alarm since measurement start
+            std::unique_ptr<uint64_t[]> alarms_;
         };
     }
 }
@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Boot Timing class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "jbdrivers/BootTiming.hpp"
+
+#if CONFIG_BOOT_TIMING_ENABLE
+
+#include "esp_timer.h"
+
+using namespace ::jblib::jbdrivers;
+
+BootTiming::Mark_t BootTiming::marks_[MARKS_COUNT] = {};
+std::atomic<uint32_t> BootTiming::marksCount_{0};
+
+
+
+void BootTiming::mark(const char* phase)
+{
+    const int64_t timeUs = esp_timer_get_time();
+    const uint32_t index = marksCount_.fetch_add(1, std::memory_order_relaxed);
+    if(index >= MARKS_COUNT){
+        marksCount_.store(MARKS_COUNT, std::memory_order_relaxed);
+        return;
+    }
+    marks_[index].timeUs = timeUs;
+    std::atomic_thread_fence(std::memory_order_release);
+    marks_[index].phase = phase;
+}
+
+
+
+size_t BootTiming::getMarksCount()
+{
+    const uint32_t count = marksCount_.load(std::memory_order_relaxed);
+    return (count < MARKS_COUNT) ? count : MARKS_COUNT;
+}
+
+
+
+BootTiming::Mark_t BootTiming::getMark(size_t index)
+{
+    Mark_t mark{nullptr, 0};
+    if(index < getMarksCount()){
+        mark.phase = marks_[index].phase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        mark.timeUs = marks_[index].timeUs;
+    }
+    return mark;
+}
+
+
+
+void BootTiming::print()
+{
+    int64_t previousUs = 0;
+    const size_t count = getMarksCount();
+    for(size_t i = 0; i < count; i++){
+        const Mark_t mark = getMark(i);
+        if(!mark.phase){
+            continue;
+        }
+        ESP_LOGI(logTag_, "%-24s at %8lld us, took %8lld us", mark.phase,
+                static_cast<long long>(mark.timeUs), static_cast<long long>(mark.timeUs - previousUs));
+        previousUs = mark.timeUs;
+    }
+}
+
+#endif
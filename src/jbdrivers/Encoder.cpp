@@ -28,49 +28,41 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "jbdrivers/Encoder.hpp"
-#include <esp_pthread.h>
-#include <thread>
+#include "esp_timer.h"
+#include <stdexcept>
+#include "soc/pcnt_struct.h"
 
 using namespace ::jblib::jbdrivers;
 
+constexpr int8_t Encoder::QUADRATURE_TABLE[16];
+
+
+
 Encoder::Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, bool useInterrupt) :
-e1Pin_(e1Pin), e2Pin_(e2Pin), useInterrupt_(useInterrupt)
+Encoder(e1Pin, e2Pin, useInterrupt ? MODE_INTERRUPT : MODE_POLLING)
 {
+
+}
+
+
+
+Encoder::Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, Mode_t mode, uint8_t stepsPerDetent) :
+e1Pin_(e1Pin), e2Pin_(e2Pin), mode_(mode), stepsPerDetent_(stepsPerDetent)
+{
+    if(this->mode_ == MODE_PCNT){
+        this->pcntConfig_.stepsPerDetent = stepsPerDetent;
+        this->initializePcnt();
+        return;
+    }
     gpio_pad_select_gpio(this->e1Pin_);
     gpio_set_direction(this->e1Pin_, GPIO_MODE_INPUT);
     gpio_set_pull_mode(this->e1Pin_, GPIO_PULLUP_ONLY);
 
-    if(this->useInterrupt_){
-        GpioInterrupt::Configuration configuration;
-        configuration.pin = this->e2Pin_;
-        configuration.pullUp = GPIO_PULLUP_ENABLE;
-        configuration.pullDown = GPIO_PULLDOWN_DISABLE;
-        configuration.edge = GPIO_INTR_NEGEDGE;
-        this->gpioInterrupt_ = std::unique_ptr<GpioInterrupt>(new GpioInterrupt(configuration));
-        this->gpioInterrupt_->addCallback([this](void*, void*){
-            this->state_ = gpio_get_level(this->e1Pin_) ? STATE_LEFT : STATE_RIGHT;
-            this->gpioInterrupt_->disable();
-            BaseType_t isAwake = 0;
-            xSemaphoreGiveFromISR(this->filterSem_,&isAwake);
-            if(isAwake) {
-                portYIELD_FROM_ISR();
-            }
-        });
-
-        auto cfg = esp_pthread_get_default_config();
-        cfg.thread_name = "[Encoder Filter]";
-        cfg.stack_size = CONFIG_ENCODER_FILTER_TASK_STACK_SIZE;
-        cfg.prio = CONFIG_ENCODER_FILTER_TASK_PRIORITY;
-        esp_pthread_set_cfg(&cfg);
-        std::thread defenceFilterThread([this](){
-            while(true){
-                xSemaphoreTake(this->filterSem_,portMAX_DELAY);
-                vTaskDelay(pdMS_TO_TICKS(CONFIG_ENCODER_FILTER_DELAY_MS));
-                this->gpioInterrupt_->enable();
-            }
-        });
-        defenceFilterThread.detach();
-        this->gpioInterrupt_->enable();
+    if(this->mode_ == MODE_INTERRUPT){
+        this->initializeInterrupt();
+    }
+    else if(this->mode_ == MODE_QUADRATURE){
+        this->initializeQuadrature();
     }
     else{
         gpio_pad_select_gpio(this->e2Pin_);
@@ -81,9 +73,279 @@ e1Pin_(e1Pin), e2Pin_(e2Pin), useInterrupt_(useInterrupt)
 
 
 
+Encoder::Encoder(gpio_num_t e1Pin, gpio_num_t e2Pin, const PcntConfiguration& configuration) :
+e1Pin_(e1Pin), e2Pin_(e2Pin), mode_(MODE_PCNT), pcntConfig_(configuration),
+stepsPerDetent_(configuration.stepsPerDetent)
+{
+    this->initializePcnt();
+}
+
+
+
+void Encoder::initializeInterrupt()
+{
+    GpioInterrupt::Configuration configuration;
+    configuration.pin = this->e2Pin_;
+    configuration.pullUp = GPIO_PULLUP_ENABLE;
+    configuration.pullDown = GPIO_PULLDOWN_DISABLE;
+    configuration.edge = GPIO_INTR_NEGEDGE;
+    this->gpioInterrupt_ = std::unique_ptr<GpioInterrupt>(new GpioInterrupt(configuration));
+    this->gpioInterrupt_->addIsrCallback([this](void*, void*){
+        this->state_ = gpio_get_level(this->e1Pin_) ? STATE_LEFT : STATE_RIGHT;
+        this->gpioInterrupt_->disableFor(CONFIG_ENCODER_FILTER_DELAY_MS);
+    });
+    this->gpioInterrupt_->enable();
+}
+
+
+
+void Encoder::initializeQuadrature()
+{
+    GpioInterrupt::Configuration configuration;
+    configuration.pin = this->e1Pin_;
+    configuration.pullUp = GPIO_PULLUP_ENABLE;
+    configuration.pullDown = GPIO_PULLDOWN_DISABLE;
+    configuration.edge = GPIO_INTR_ANYEDGE;
+    this->e1Interrupt_ = std::unique_ptr<GpioInterrupt>(new GpioInterrupt(configuration));
+    configuration.pin = this->e2Pin_;
+    this->gpioInterrupt_ = std::unique_ptr<GpioInterrupt>(new GpioInterrupt(configuration));
+    this->quadratureState_ = static_cast<uint8_t>((gpio_get_level(this->e1Pin_) << 1) |
+            gpio_get_level(this->e2Pin_));
+    auto decode = [this](void*, void*){
+        this->decodeQuadrature();
+    };
+    this->e1Interrupt_->addIsrCallback(decode);
+    this->gpioInterrupt_->addIsrCallback(decode);
+    this->e1Interrupt_->enable();
+    this->gpioInterrupt_->enable();
+}
+
+
+
+void IRAM_ATTR Encoder::decodeQuadrature()
+{
+    const auto state = static_cast<uint8_t>((gpio_get_level(this->e1Pin_) << 1) | gpio_get_level(this->e2Pin_));
+    const uint8_t index = (this->quadratureState_ << 2) | state;
+    this->quadratureState_ = state;
+    if(QUADRATURE_INVALID_MASK & (1 << index)){
+        this->invalidTransitionsCount_++;
+        return;
+    }
+    const int8_t step = QUADRATURE_TABLE[index];
+    if(step == 0){
+        return;
+    }
+    //single producer (GPIO ISR), single consumer (readSteps)
+    const uint32_t head = this->stepsHead_.load(std::memory_order_relaxed);
+    if((head - this->stepsTail_.load(std::memory_order_acquire)) >= STEPS_QUEUE_SIZE){
+        return;
+    }
+    this->steps_[head & (STEPS_QUEUE_SIZE - 1)] = step;
+    this->stepsHead_.store(head + 1, std::memory_order_release);
+}
+
+
+
+size_t Encoder::readSteps(int8_t* steps, size_t maxCount)
+{
+    const uint32_t head = this->stepsHead_.load(std::memory_order_acquire);
+    uint32_t tail = this->stepsTail_.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while((tail != head) && (count < maxCount)){
+        steps[count++] = this->steps_[tail & (STEPS_QUEUE_SIZE - 1)];
+        tail++;
+    }
+    this->stepsTail_.store(tail, std::memory_order_release);
+    return count;
+}
+
+
+
+uint32_t Encoder::getInvalidTransitionsCount() const
+{
+    return this->invalidTransitionsCount_;
+}
+
+
+
+void Encoder::initializePcnt()
+{
+    //x4 quadrature decoding: both edges of both inputs are counted, level of other input sets direction
+    pcnt_config_t pcntConfig{};
+    pcntConfig.unit = this->pcntConfig_.unit;
+    pcntConfig.counter_h_lim = this->pcntConfig_.countLimit;
+    pcntConfig.counter_l_lim = static_cast<int16_t>(-this->pcntConfig_.countLimit);
+
+    pcntConfig.channel = PCNT_CHANNEL_0;
+    pcntConfig.pulse_gpio_num = this->e1Pin_;
+    pcntConfig.ctrl_gpio_num = this->e2Pin_;
+    pcntConfig.pos_mode = PCNT_COUNT_DEC;
+    pcntConfig.neg_mode = PCNT_COUNT_INC;
+    pcntConfig.lctrl_mode = PCNT_MODE_REVERSE;
+    pcntConfig.hctrl_mode = PCNT_MODE_KEEP;
+    esp_err_t ret = pcnt_unit_config(&pcntConfig);
+
+    pcntConfig.channel = PCNT_CHANNEL_1;
+    pcntConfig.pulse_gpio_num = this->e2Pin_;
+    pcntConfig.ctrl_gpio_num = this->e1Pin_;
+    pcntConfig.pos_mode = PCNT_COUNT_INC;
+    pcntConfig.neg_mode = PCNT_COUNT_DEC;
+    if(ret == ESP_OK){
+        ret = pcnt_unit_config(&pcntConfig);
+    }
+    if(ret != ESP_OK){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::logic_error("PCNT unit config error");
+        #else
+        ESP_LOGE(logTag_, "PCNT unit config error %i", ret);
+        return;
+        #endif
+    }
+    gpio_set_pull_mode(this->e1Pin_, GPIO_PULLUP_ONLY);
+    gpio_set_pull_mode(this->e2Pin_, GPIO_PULLUP_ONLY);
+
+    pcnt_counter_pause(this->pcntConfig_.unit);
+    pcnt_counter_clear(this->pcntConfig_.unit);
+    pcnt_set_filter_value(this->pcntConfig_.unit, this->pcntConfig_.filterValue);
+    pcnt_filter_enable(this->pcntConfig_.unit);
+    pcnt_event_enable(this->pcntConfig_.unit, PCNT_EVT_H_LIM);
+    pcnt_event_enable(this->pcntConfig_.unit, PCNT_EVT_L_LIM);
+
+    ret = pcnt_isr_service_install(0);
+    if((ret != ESP_OK) && (ret != ESP_ERR_INVALID_STATE)){
+        ESP_LOGE(logTag_, "Install PCNT isr service error %i", ret);
+    }
+    ret = pcnt_isr_handler_add(this->pcntConfig_.unit, pcntIsrHandler, this);
+    if(ret != ESP_OK){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::logic_error("Add PCNT ISR handler error");
+        #else
+        ESP_LOGE(logTag_, "Add PCNT ISR handler error %i", ret);
+        #endif
+    }
+    pcnt_intr_enable(this->pcntConfig_.unit);
+    this->velocityTimeUs_ = esp_timer_get_time();
+    pcnt_counter_resume(this->pcntConfig_.unit);
+}
+
+
+
+Encoder::~Encoder()
+{
+    if(this->mode_ == MODE_PCNT){
+        pcnt_counter_pause(this->pcntConfig_.unit);
+        pcnt_intr_disable(this->pcntConfig_.unit);
+        pcnt_isr_handler_remove(this->pcntConfig_.unit);
+    }
+}
+
+
+
+void IRAM_ATTR Encoder::pcntIsrHandler(void* arg)
+{
+    auto encoder = reinterpret_cast<Encoder*>(arg);
+    uint32_t status = 0;
+    #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0))
+    pcnt_get_event_status(encoder->pcntConfig_.unit, &status);
+    #else
+    status = PCNT.status_unit[encoder->pcntConfig_.unit].val;
+    #endif
+    //counter is reset to zero by hardware on reaching a limit
+    if(status & PCNT_EVT_H_LIM){
+        encoder->overflowPosition_.fetch_add(encoder->pcntConfig_.countLimit, std::memory_order_relaxed);
+    }
+    else if(status & PCNT_EVT_L_LIM){
+        encoder->overflowPosition_.fetch_sub(encoder->pcntConfig_.countLimit, std::memory_order_relaxed);
+    }
+}
+
+
+
+int32_t Encoder::getPosition()
+{
+    if(this->mode_ != MODE_PCNT){
+        return 0;
+    }
+    //hardware clears counter on reaching a limit before overflow ISR adds it to position,
+    //so count read while limit interrupt is pending is off by countLimit: wait for ISR and re-read
+    const uint32_t unitMask = 1UL << this->pcntConfig_.unit;
+    int32_t overflowPosition = 0;
+    int16_t count = 0;
+    bool isOverflowPending = false;
+    do{
+        overflowPosition = this->overflowPosition_.load(std::memory_order_relaxed);
+        pcnt_get_counter_value(this->pcntConfig_.unit, &count);
+        isOverflowPending = (PCNT.int_raw.val & unitMask) != 0;
+    } while(isOverflowPending || (overflowPosition != this->overflowPosition_.load(std::memory_order_relaxed)));
+    return overflowPosition + count;
+}
+
+
+
+void Encoder::resetPosition()
+{
+    if(this->mode_ != MODE_PCNT){
+        return;
+    }
+    pcnt_counter_pause(this->pcntConfig_.unit);
+    pcnt_counter_clear(this->pcntConfig_.unit);
+    this->overflowPosition_ = 0;
+    this->statePosition_ = 0;
+    this->velocityPosition_ = 0;
+    this->velocityTimeUs_ = esp_timer_get_time();
+    pcnt_counter_resume(this->pcntConfig_.unit);
+}
+
+
+
+float Encoder::getVelocity()
+{
+    if(this->mode_ != MODE_PCNT){
+        return 0;
+    }
+    const int64_t timeUs = esp_timer_get_time();
+    const int64_t periodUs = timeUs - this->velocityTimeUs_;
+    if(periodUs >= MIN_VELOCITY_PERIOD_US){
+        const int32_t position = this->getPosition();
+        this->velocity_ = (static_cast<float>(position - this->velocityPosition_) * 1000000.0f) /
+                static_cast<float>(periodUs);
+        this->velocityPosition_ = position;
+        this->velocityTimeUs_ = timeUs;
+    }
+    return this->velocity_;
+}
+
+
+
 Encoder::State_t Encoder::getState()
 {
-    if(!this->useInterrupt_){
+    if(this->mode_ == MODE_PCNT){
+        const int32_t delta = this->getPosition() - this->statePosition_;
+        if(delta >= this->stepsPerDetent_){
+            this->state_ = STATE_RIGHT;
+            this->statePosition_ += delta;
+        }
+        else if(delta <= -static_cast<int32_t>(this->stepsPerDetent_)){
+            this->state_ = STATE_LEFT;
+            this->statePosition_ += delta;
+        }
+    }
+    else if(this->mode_ == MODE_QUADRATURE){
+        int8_t steps[STEPS_QUEUE_SIZE];
+        const size_t count = this->readSteps(steps, STEPS_QUEUE_SIZE);
+        for(size_t i = 0; i < count; i++){
+            this->pendingSteps_ += steps[i];
+        }
+        if(this->pendingSteps_ >= this->stepsPerDetent_){
+            this->state_ = STATE_RIGHT;
+            this->pendingSteps_ -= this->stepsPerDetent_;
+        }
+        else if(this->pendingSteps_ <= -static_cast<int32_t>(this->stepsPerDetent_)){
+            this->state_ = STATE_LEFT;
+            this->pendingSteps_ += this->stepsPerDetent_;
+        }
+    }
+    else if(this->mode_ == MODE_POLLING){
         bool e1State = gpio_get_level(this->e1Pin_);
         bool e2State = gpio_get_level(this->e2Pin_);
         if(this->checkEncoder_){
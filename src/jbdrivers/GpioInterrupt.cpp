@@ -29,6 +29,8 @@
 
 #include <stdexcept>
 #include "jbdrivers/GpioInterrupt.hpp"
+#include "esp_timer.h"
+#include "jbdrivers/Profiler.hpp"
 
 using namespace ::jblib::jbkernel;
 using namespace ::jblib::jbdrivers;
@@ -47,16 +49,46 @@ void GpioInterrupt::globalEnableGpioInterrupt(uint32_t intrFlags)
 
 void GpioInterrupt::globalDisableGpioInterrupt()
 {
+    if(GpioInterruptDispatcher::getGpioInterruptDispatcher()){
+        GpioInterruptDispatcher::uninstall();
+        return;
+    }
     gpio_uninstall_isr_service();
 }
 
 
 
+void GpioInterrupt::globalEnableBatchedGpioInterrupt(uint32_t intrFlags)
+{
+    GpioInterruptDispatcher::install(intrFlags);
+}
+
+
+
 void IRAM_ATTR GpioInterrupt::isrHandler(void* arg)
 {
+    const int64_t timestampUs = esp_timer_get_time();
     auto gpioInterrupt = reinterpret_cast<GpioInterrupt*>(arg);
-    if(gpioInterrupt->callback_ != nullptr){
-        gpioInterrupt->callback_(arg, gpioInterrupt->callbackParameter_);
+    if(!gpioInterrupt->processEdge(timestampUs)){
+        return;
+    }
+    gpioInterrupt->callCallback();
+}
+
+
+
+void IRAM_ATTR GpioInterrupt::callCallback()
+{
+    JB_PROFILE_SCOPE(PROFILER_PROBE_GPIO_CALLBACK);
+    portENTER_CRITICAL_SAFE(&this->callbackMutex_);
+    const IsrDelegate isrCallback = this->isrCallback_;
+    void* const parameter = this->callbackParameter_;
+    portEXIT_CRITICAL_SAFE(&this->callbackMutex_);
+    if(isrCallback){
+        isrCallback(this, parameter);
+    }
+    else if(this->callback_ != nullptr){
+        this->callback_(this, this->callbackParameter_);
     }
 }
 
@@ -64,6 +96,30 @@ void IRAM_ATTR GpioInterrupt::isrHandler(void* arg)
 
 GpioInterrupt::GpioInterrupt(const Configuration& config) : CallbackCaller(), pin_(config.pin)
 {
+    vPortCPUInitializeMutex(&this->captureMutex_);
+    vPortCPUInitializeMutex(&this->callbackMutex_);
+    this->rearmService_ = &GpioRearmService::getGpioRearmService();
+    this->edge_ = config.edge;
+    if(config.captureEdges){
+        this->captures_ = std::unique_ptr<int64_t[]>(new int64_t[CAPTURE_RING_SIZE]);
+    }
+    if(config.maxEdgesPerSecond){
+        this->windowEdgesLimit_ = static_cast<uint32_t>((static_cast<int64_t>(config.maxEdgesPerSecond) *
+                RATE_WINDOW_US) / 1000000);
+        if(this->windowEdgesLimit_ == 0){
+            this->windowEdgesLimit_ = 1;
+        }
+        this->settleTicks_ = (config.settleTimeMs + CONFIG_GPIO_REARM_TICK_MS - 1) / CONFIG_GPIO_REARM_TICK_MS;
+    }
+    auto dispatcher = GpioInterruptDispatcher::getGpioInterruptDispatcher();
+    if(dispatcher && ((config.edge == GPIO_INTR_LOW_LEVEL) || (config.edge == GPIO_INTR_HIGH_LEVEL))){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::invalid_argument("Level interrupt is not supported in batched mode");
+        #else
+        ESP_LOGE(logTag_, "Level interrupt is not supported in batched mode");
+        return;
+        #endif
+    }
     gpio_config_t gpioConfig{};
     gpioConfig.pin_bit_mask = 1ULL << static_cast<uint32_t>(config.pin);
     gpioConfig.mode = GPIO_MODE_INPUT;
@@ -78,6 +134,12 @@ GpioInterrupt::GpioInterrupt(const Configuration& config) : CallbackCaller(), pi
         return;
         #endif
     }
+    if(dispatcher){
+        this->isBatched_ = true;
+        dispatcher->addPin(config.pin, *this);
+        this->disable();
+        return;
+    }
     auto ret = gpio_isr_handler_add(config.pin, isrHandler, this);
     if(ret == ESP_ERR_INVALID_STATE){
         globalEnableGpioInterrupt();
@@ -97,7 +159,17 @@ GpioInterrupt::GpioInterrupt(const Configuration& config) : CallbackCaller(), pi
 
 GpioInterrupt::~GpioInterrupt()
 {
-    gpio_isr_handler_remove(this->pin_);
+    if(this->isBatched_){
+        gpio_intr_disable(this->pin_);
+        auto dispatcher = GpioInterruptDispatcher::getGpioInterruptDispatcher();
+        if(dispatcher){
+            dispatcher->removePin(this->pin_);
+        }
+    }
+    else{
+        gpio_isr_handler_remove(this->pin_);
+    }
+    this->rearmService_->cancel(*this);
     gpio_reset_pin(this->pin_);
 }
 
@@ -114,3 +186,193 @@ void GpioInterrupt::disable()
 {
     gpio_intr_disable(this->pin_);
 }
+
+
+
+void GpioInterrupt::addIsrCallback(const IsrDelegate& callback, void* parameter)
+{
+    portENTER_CRITICAL(&this->callbackMutex_);
+    this->isrCallback_ = callback;
+    this->callbackParameter_ = parameter;
+    portEXIT_CRITICAL(&this->callbackMutex_);
+}
+
+
+
+void GpioInterrupt::deleteIsrCallback()
+{
+    portENTER_CRITICAL(&this->callbackMutex_);
+    this->isrCallback_ = IsrDelegate();
+    portEXIT_CRITICAL(&this->callbackMutex_);
+}
+
+
+
+void IRAM_ATTR GpioInterrupt::disableFor(uint32_t delayMs)
+{
+    gpio_intr_disable(this->pin_);
+    this->rearmService_->rearmAfter(*this, delayMs);
+}
+
+
+
+/// Captures edge and applies rate governor. @return false if edge is dropped due to interrupt storm
+bool IRAM_ATTR GpioInterrupt::processEdge(int64_t timestampUs)
+{
+    if(this->captures_){
+        this->capture(timestampUs);
+    }
+    this->statistics_.edgesCount++;
+    if(!this->windowEdgesLimit_){
+        return true;
+    }
+    if((timestampUs - this->windowStartUs_) >= RATE_WINDOW_US){
+        this->windowStartUs_ = timestampUs;
+        this->windowEdges_ = 0;
+    }
+    if(++this->windowEdges_ <= this->windowEdgesLimit_){
+        return true;
+    }
+    gpio_intr_disable(this->pin_);
+    this->statistics_.stormsCount++;
+    this->statistics_.isStormActive = true;
+    this->stormLevel_ = gpio_get_level(this->pin_);
+    this->stableTicks_ = 0;
+    this->rearmService_->rearmAfter(*this, CONFIG_GPIO_REARM_TICK_MS);
+    return false;
+}
+
+
+
+/**
+ * Called by re-arm service on delay expiration.
+ * @return 0 if interrupt is enabled, otherwise number of ticks until next check
+ */
+uint32_t GpioInterrupt::onRearm()
+{
+    if(this->statistics_.isStormActive){
+        const int level = gpio_get_level(this->pin_);
+        if(level != this->stormLevel_){
+            this->stormLevel_ = level;
+            this->stableTicks_ = 0;
+            this->isStormEdge_ = (this->edge_ == GPIO_INTR_ANYEDGE) ||
+                    ((this->edge_ == GPIO_INTR_POSEDGE) && level) || ((this->edge_ == GPIO_INTR_NEGEDGE) && !level);
+            return 1;
+        }
+        if(++this->stableTicks_ < this->settleTicks_){
+            return 1;
+        }
+        this->statistics_.isStormActive = false;
+        this->windowEdges_ = 0;
+    }
+    this->enable();
+    return 0;
+}
+
+
+
+/// Level change of storm-masked pin found by polling, called by re-arm service from timer task
+void GpioInterrupt::onStormEdge()
+{
+    this->statistics_.edgesCount++;
+    if(this->captures_){
+        this->capture(esp_timer_get_time());
+    }
+    this->callCallback();
+}
+
+
+
+GpioInterrupt::Statistics_t GpioInterrupt::getStatistics() const
+{
+    return this->statistics_;
+}
+
+
+
+void IRAM_ATTR GpioInterrupt::capture(int64_t timestampUs)
+{
+    portENTER_CRITICAL_SAFE(&this->captureMutex_);
+    this->captures_[this->capturesHead_ & (CAPTURE_RING_SIZE - 1)] = timestampUs;
+    this->capturesHead_++;
+    if((this->capturesHead_ - this->capturesTail_) > CAPTURE_RING_SIZE){
+        this->capturesTail_ = this->capturesHead_ - CAPTURE_RING_SIZE;
+        this->capturesOverflowCount_++;
+    }
+    portEXIT_CRITICAL_SAFE(&this->captureMutex_);
+}
+
+
+
+size_t GpioInterrupt::readCaptures(int64_t* timestampsUs, size_t maxCount)
+{
+    if(!this->captures_){
+        return 0;
+    }
+    size_t count = 0;
+    portENTER_CRITICAL(&this->captureMutex_);
+    while((this->capturesTail_ != this->capturesHead_) && (count < maxCount)){
+        timestampsUs[count++] = this->captures_[this->capturesTail_ & (CAPTURE_RING_SIZE - 1)];
+        this->capturesTail_++;
+    }
+    portEXIT_CRITICAL(&this->captureMutex_);
+    return count;
+}
+
+
+
+uint32_t GpioInterrupt::getCapturesCount()
+{
+    portENTER_CRITICAL(&this->captureMutex_);
+    const uint32_t count = this->capturesHead_;
+    portEXIT_CRITICAL(&this->captureMutex_);
+    return count;
+}
+
+
+
+uint32_t GpioInterrupt::getCapturesOverflowCount()
+{
+    portENTER_CRITICAL(&this->captureMutex_);
+    const uint32_t count = this->capturesOverflowCount_;
+    portEXIT_CRITICAL(&this->captureMutex_);
+    return count;
+}
+
+
+
+int64_t GpioInterrupt::getLastIntervalUs()
+{
+    if(!this->captures_){
+        return 0;
+    }
+    int64_t intervalUs = 0;
+    portENTER_CRITICAL(&this->captureMutex_);
+    if(this->capturesHead_ >= 2){
+        intervalUs = this->captures_[(this->capturesHead_ - 1) & (CAPTURE_RING_SIZE - 1)] -
+                this->captures_[(this->capturesHead_ - 2) & (CAPTURE_RING_SIZE - 1)];
+    }
+    portEXIT_CRITICAL(&this->captureMutex_);
+    return intervalUs;
+}
+
+
+
+float GpioInterrupt::getFrequency()
+{
+    if(!this->captures_){
+        return 0;
+    }
+    portENTER_CRITICAL(&this->captureMutex_);
+    const uint32_t count = (this->capturesHead_ < CAPTURE_RING_SIZE) ? this->capturesHead_ : CAPTURE_RING_SIZE;
+    int64_t spanUs = 0;
+    if(count >= 2){
+        spanUs = this->captures_[(this->capturesHead_ - 1) & (CAPTURE_RING_SIZE - 1)] -
+                this->captures_[(this->capturesHead_ - count) & (CAPTURE_RING_SIZE - 1)];
+    }
+    portEXIT_CRITICAL(&this->captureMutex_);
+    if(spanUs <= 0){
+        return 0;
+    }
+    return (static_cast<float>(count - 1) * 1000000.0f) / static_cast<float>(spanUs);
+}
@@ -0,0 +1,228 @@
+/**
+ * @file
+ * @brief GPIO Interrupt Dispatcher class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdexcept>
+#include <new>
+#include <type_traits>
+#include <esp_pthread.h>
+#include "esp_timer.h"
+#include "soc/gpio_struct.h"
+#include "jbdrivers/GpioInterruptDispatcher.hpp"
+#include "jbdrivers/GpioInterrupt.hpp"
+
+using namespace ::jblib::jbkernel;
+using namespace ::jblib::jbdrivers;
+
+GpioInterruptDispatcher* GpioInterruptDispatcher::dispatcher_ = nullptr;
+static std::aligned_storage<sizeof(GpioInterruptDispatcher), alignof(GpioInterruptDispatcher)>::type dispatcherStorage;
+static std::mutex installMutex;
+
+
+
+/// Dispatcher is constructed in static storage. Constructor starts a task, so guard is a mutex, not a spinlock
+void GpioInterruptDispatcher::install(uint32_t intrFlags)
+{
+    std::lock_guard<std::mutex> lock(installMutex);
+    if(dispatcher_){
+        return;
+    }
+    dispatcher_ = new(&dispatcherStorage) GpioInterruptDispatcher(intrFlags);
+}
+
+
+
+void GpioInterruptDispatcher::uninstall()
+{
+    std::lock_guard<std::mutex> lock(installMutex);
+    if(dispatcher_){
+        dispatcher_->~GpioInterruptDispatcher();
+        dispatcher_ = nullptr;
+    }
+}
+
+
+
+GpioInterruptDispatcher* GpioInterruptDispatcher::getGpioInterruptDispatcher()
+{
+    return dispatcher_;
+}
+
+
+
+GpioInterruptDispatcher::GpioInterruptDispatcher(uint32_t intrFlags)
+{
+    vPortCPUInitializeMutex(&this->overflowMutex_);
+    this->eventSemaphore_ = xSemaphoreCreateBinary();
+    if(!this->eventSemaphore_){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::bad_alloc();
+        #else
+        ESP_LOGE(logTag_, "Create event semaphore error");
+        return;
+        #endif
+    }
+    auto cfg = esp_pthread_get_default_config();
+    cfg.thread_name = logTag_;
+    cfg.stack_size = CONFIG_GPIO_DISPATCHER_TASK_STACK_SIZE;
+    cfg.prio = CONFIG_GPIO_DISPATCHER_TASK_PRIORITY;
+    esp_pthread_set_cfg(&cfg);
+    this->isRunning_ = true;
+    this->dispatcherThread_ = std::thread(&GpioInterruptDispatcher::dispatcher, this);
+
+    auto ret = gpio_isr_register(isrHandler, this, static_cast<int>(intrFlags), &this->isrHandle_);
+    if(ret != ESP_OK){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::logic_error("Register GPIO ISR error");
+        #else
+        ESP_LOGE(logTag_, "Register GPIO ISR error %i", ret);
+        #endif
+    }
+}
+
+
+
+GpioInterruptDispatcher::~GpioInterruptDispatcher()
+{
+    if(this->isrHandle_){
+        esp_intr_free(this->isrHandle_);
+    }
+    if(this->isRunning_){
+        this->isRunning_ = false;
+        xSemaphoreGive(this->eventSemaphore_);
+        this->dispatcherThread_.join();
+    }
+    if(this->eventSemaphore_){
+        vSemaphoreDelete(this->eventSemaphore_);
+    }
+}
+
+
+
+void GpioInterruptDispatcher::addPin(gpio_num_t pin, GpioInterrupt& interrupt)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->pinsMutex_);
+    this->pins_[pin] = &interrupt;
+}
+
+
+
+void GpioInterruptDispatcher::removePin(gpio_num_t pin)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->pinsMutex_);
+    this->pins_[pin] = nullptr;
+}
+
+
+
+void IRAM_ATTR GpioInterruptDispatcher::isrHandler(void* arg)
+{
+    const int64_t timestampUs = esp_timer_get_time();
+    auto dispatcher = reinterpret_cast<GpioInterruptDispatcher*>(arg);
+    uint32_t status = 0;
+    uint32_t status1 = 0;
+    if(xPortGetCoreID() == 0){
+        status = GPIO.pcpu_int;
+        status1 = GPIO.pcpu_int1.intr;
+    }
+    else{
+        status = GPIO.acpu_int;
+        status1 = GPIO.acpu_int1.intr;
+    }
+    if(!status && !status1){
+        return;
+    }
+    GPIO.status_w1tc = status;
+    GPIO.status1_w1tc.intr_st = status1;
+    const uint64_t pinsMask = (static_cast<uint64_t>(status1) << 32) | status;
+
+    const uint32_t head = dispatcher->eventsHead_.load(std::memory_order_relaxed);
+    if((head - dispatcher->eventsTail_.load(std::memory_order_acquire)) < QUEUE_SIZE){
+        auto& event = dispatcher->events_[head & (QUEUE_SIZE - 1)];
+        event.pinsMask = pinsMask;
+        event.timestampUs = timestampUs;
+        dispatcher->eventsHead_.store(head + 1, std::memory_order_release);
+    }
+    else{
+        portENTER_CRITICAL_ISR(&dispatcher->overflowMutex_);
+        if(!dispatcher->overflowMask_){
+            dispatcher->overflowTimestampUs_ = timestampUs;
+        }
+        dispatcher->overflowMask_ |= pinsMask;
+        dispatcher->droppedEventsCount_++;
+        portEXIT_CRITICAL_ISR(&dispatcher->overflowMutex_);
+    }
+    BaseType_t isAwake = 0;
+    xSemaphoreGiveFromISR(dispatcher->eventSemaphore_, &isAwake);
+    if(isAwake){
+        portYIELD_FROM_ISR();
+    }
+}
+
+
+
+void GpioInterruptDispatcher::dispatcher()
+{
+    while(true){
+        xSemaphoreTake(this->eventSemaphore_, portMAX_DELAY);
+        if(!this->isRunning_){
+            return;
+        }
+        uint32_t tail = this->eventsTail_.load(std::memory_order_relaxed);
+        while(tail != this->eventsHead_.load(std::memory_order_acquire)){
+            const Event_t event = this->events_[tail & (QUEUE_SIZE - 1)];
+            this->eventsTail_.store(++tail, std::memory_order_release);
+            this->dispatch(event.pinsMask, event.timestampUs);
+        }
+        portENTER_CRITICAL(&this->overflowMutex_);
+        const uint64_t overflowMask = this->overflowMask_;
+        const int64_t overflowTimestampUs = this->overflowTimestampUs_;
+        this->overflowMask_ = 0;
+        portEXIT_CRITICAL(&this->overflowMutex_);
+        if(overflowMask){
+            this->dispatch(overflowMask, overflowTimestampUs);
+        }
+    }
+}
+
+
+
+void GpioInterruptDispatcher::dispatch(uint64_t pinsMask, int64_t timestampUs)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->pinsMutex_);
+    this->eventTimeUs_ = timestampUs;
+    while(pinsMask){
+        const auto pin = static_cast<uint32_t>(__builtin_ctzll(pinsMask));
+        pinsMask &= pinsMask - 1;
+        GpioInterrupt* interrupt = (pin < GPIO_NUM_MAX) ? this->pins_[pin] : nullptr;
+        if(!interrupt || !interrupt->processEdge(timestampUs)){
+            continue;
+        }
+        interrupt->callCallback();
+    }
+}
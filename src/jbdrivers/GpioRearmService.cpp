@@ -0,0 +1,228 @@
+/**
+ * @file
+ * @brief GPIO Interrupt Re-arm Service class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include "jbdrivers/GpioRearmService.hpp"
+#include "jbdrivers/GpioInterrupt.hpp"
+
+using namespace ::jblib::jbdrivers;
+
+
+
+/**
+ * Service is constructed in static storage on first request from task, timer is static too,
+ * so nothing is allocated. Timer is created out of critical section.
+ */
+GpioRearmService& GpioRearmService::getGpioRearmService()
+{
+    typedef std::aligned_storage<sizeof(GpioRearmService), alignof(GpioRearmService)>::type Storage_t;
+    static Storage_t storage;
+    static std::once_flag serviceFlag;
+    std::call_once(serviceFlag, []{
+        new(&storage) GpioRearmService();
+    });
+    return *reinterpret_cast<GpioRearmService*>(&storage);
+}
+
+
+
+GpioRearmService::GpioRearmService()
+{
+    vPortCPUInitializeMutex(&this->mutex_);
+    TickType_t period = pdMS_TO_TICKS(TICK_MS);
+    if(period == 0){
+        period = 1;
+    }
+    this->timer_ = xTimerCreateStatic("GpioRearm", period, pdFALSE, this, timerCallback, &this->timerBuffer_);
+}
+
+
+
+void IRAM_ATTR GpioRearmService::rearmAfter(GpioInterrupt& interrupt, uint32_t delayMs)
+{
+    uint32_t ticks = (delayMs + TICK_MS - 1) / TICK_MS;
+    if(ticks == 0){
+        ticks = 1;
+    }
+    portENTER_CRITICAL_SAFE(&this->mutex_);
+    if(interrupt.isRearmPending_){
+        this->unlink(interrupt);
+    }
+    if(this->isRunning_){
+        ticks++; //current tick is already in progress
+    }
+    this->insert(interrupt, this->currentTick_ + ticks);
+    const bool isStartRequired = !this->isRunning_;
+    this->isRunning_ = true;
+    portEXIT_CRITICAL_SAFE(&this->mutex_);
+
+    if(isStartRequired){
+        BaseType_t isStarted;
+        if(xPortInIsrContext()){
+            BaseType_t isAwake = 0;
+            isStarted = xTimerStartFromISR(this->timer_, &isAwake);
+            if(isAwake){
+                portYIELD_FROM_ISR();
+            }
+        }
+        else{
+            isStarted = xTimerStart(this->timer_, 0);
+        }
+        //timer command queue is full, next rearm request starts timer again
+        if(isStarted != pdPASS){
+            portENTER_CRITICAL_SAFE(&this->mutex_);
+            this->isRunning_ = false;
+            portEXIT_CRITICAL_SAFE(&this->mutex_);
+        }
+    }
+}
+
+
+
+void GpioRearmService::cancel(GpioInterrupt& interrupt)
+{
+    portENTER_CRITICAL_SAFE(&this->mutex_);
+    if(interrupt.isRearmPending_){
+        this->unlink(interrupt);
+    }
+    if(interrupt.isNotifyPending_){
+        GpioInterrupt** node = &this->notifyHead_;
+        while(*node != &interrupt){
+            node = &(*node)->notifyNext_;
+        }
+        *node = interrupt.notifyNext_;
+        interrupt.notifyNext_ = nullptr;
+        interrupt.isNotifyPending_ = false;
+    }
+    portEXIT_CRITICAL_SAFE(&this->mutex_);
+}
+
+
+
+uint32_t GpioRearmService::getPendingCount() const
+{
+    portENTER_CRITICAL_SAFE(&this->mutex_);
+    const uint32_t count = this->pendingCount_;
+    portEXIT_CRITICAL_SAFE(&this->mutex_);
+    return count;
+}
+
+
+
+void IRAM_ATTR GpioRearmService::unlink(GpioInterrupt& interrupt)
+{
+    GpioInterrupt** node = &this->wheel_[interrupt.rearmTick_ & (WHEEL_SIZE - 1)];
+    while(*node){
+        if(*node == &interrupt){
+            *node = interrupt.rearmNext_;
+            break;
+        }
+        node = &(*node)->rearmNext_;
+    }
+    interrupt.rearmNext_ = nullptr;
+    interrupt.isRearmPending_ = false;
+    this->pendingCount_--;
+}
+
+
+
+void IRAM_ATTR GpioRearmService::insert(GpioInterrupt& interrupt, uint32_t tick)
+{
+    interrupt.rearmTick_ = tick;
+    auto& slot = this->wheel_[tick & (WHEEL_SIZE - 1)];
+    interrupt.rearmNext_ = slot;
+    slot = &interrupt;
+    interrupt.isRearmPending_ = true;
+    this->pendingCount_++;
+}
+
+
+
+void GpioRearmService::timerCallback(TimerHandle_t timer)
+{
+    reinterpret_cast<GpioRearmService*>(pvTimerGetTimerID(timer))->processTick();
+}
+
+
+
+void GpioRearmService::processTick()
+{
+    portENTER_CRITICAL(&this->mutex_);
+    this->currentTick_++;
+    GpioInterrupt** node = &this->wheel_[this->currentTick_ & (WHEEL_SIZE - 1)];
+    while(*node){
+        GpioInterrupt* interrupt = *node;
+        //delays longer than one wheel turn stay in the slot for next rounds
+        if(static_cast<int32_t>(interrupt->rearmTick_ - this->currentTick_) <= 0){
+            *node = interrupt->rearmNext_;
+            interrupt->rearmNext_ = nullptr;
+            interrupt->isRearmPending_ = false;
+            this->pendingCount_--;
+            //storm-masked pins are polled until they settle, re-inserted nodes expire later and are skipped
+            const uint32_t ticks = interrupt->onRearm();
+            if(ticks){
+                this->insert(*interrupt, this->currentTick_ + ticks);
+            }
+            if(interrupt->isStormEdge_ && !interrupt->isNotifyPending_){
+                interrupt->notifyNext_ = this->notifyHead_;
+                this->notifyHead_ = interrupt;
+                interrupt->isNotifyPending_ = true;
+            }
+            interrupt->isStormEdge_ = false;
+        }
+        else{
+            node = &interrupt->rearmNext_;
+        }
+    }
+    const bool isRestartRequired = (this->pendingCount_ != 0);
+    this->isRunning_ = isRestartRequired;
+    portEXIT_CRITICAL(&this->mutex_);
+    if(isRestartRequired && (xTimerStart(this->timer_, 0) != pdPASS)){
+        portENTER_CRITICAL(&this->mutex_);
+        this->isRunning_ = false;
+        portEXIT_CRITICAL(&this->mutex_);
+    }
+    //callbacks of polled edges are called out of critical section, one node is taken at a time
+    while(true){
+        portENTER_CRITICAL(&this->mutex_);
+        GpioInterrupt* interrupt = this->notifyHead_;
+        if(interrupt){
+            this->notifyHead_ = interrupt->notifyNext_;
+            interrupt->notifyNext_ = nullptr;
+            interrupt->isNotifyPending_ = false;
+        }
+        portEXIT_CRITICAL(&this->mutex_);
+        if(!interrupt){
+            break;
+        }
+        interrupt->onStormEdge();
+    }
+}
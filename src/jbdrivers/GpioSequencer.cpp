@@ -0,0 +1,226 @@
+/**
+ * @file
+ * @brief GPIO Sequencer class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "jbkernel/jb_common.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
+
+#include "jbdrivers/GpioSequencer.hpp"
+
+using namespace ::jblib::jbdrivers;
+
+
+
+GpioSequencer::GpioSequencer(VoidTimer& timer, uint32_t tickUs) : timer_(timer)
+{
+    vPortCPUInitializeMutex(&this->mutex_);
+    this->timer_.initialize(tickUs);
+    this->timer_.addIsrCallback([this](void*, void*){
+        this->tick();
+    });
+}
+
+
+
+GpioSequencer::~GpioSequencer()
+{
+    this->timer_.deleteIsrCallback();
+    this->timer_.deinitialize();
+}
+
+
+
+void GpioSequencer::play(uint8_t boardGpio, const Pattern& pattern)
+{
+    if(boardGpio >= JbController::BOARD_GPIOS_COUNT){
+        ESP_LOGE(logTag_, "Wrong board GPIO %u", boardGpio);
+        return;
+    }
+    if(((pattern.onTicks == 0) && (pattern.offTicks == 0)) || (pattern.pulsesCount == 0)){
+        ESP_LOGE(logTag_, "Empty pattern for board GPIO %u", boardGpio);
+        return;
+    }
+    Channel channel{};
+    channel.pattern = pattern;
+    channel.lowMask = JbController::getGpioLowMask(boardGpio);
+    channel.highMask = JbController::getGpioHighMask(boardGpio);
+    //start from the end of pause, so the first tick switches the pin on
+    channel.phase = PHASE_PAUSE;
+    channel.remainingTicks = 1;
+    channel.repeat = static_cast<uint8_t>(-1);
+    channel.isActive = true;
+    portENTER_CRITICAL(&this->mutex_);
+    this->channels_[boardGpio] = channel;
+    const bool isTimerStopped = !this->isTimerRunning_;
+    this->isTimerRunning_ = true;
+    portEXIT_CRITICAL(&this->mutex_);
+    //timer is paused, so tick can't stop it again before it is started
+    if(isTimerStopped){
+        this->timer_.start();
+    }
+}
+
+
+
+void GpioSequencer::stop(uint8_t boardGpio, bool level)
+{
+    if(boardGpio >= JbController::BOARD_GPIOS_COUNT){
+        return;
+    }
+    const uint32_t lowMask = JbController::getGpioLowMask(boardGpio);
+    const uint32_t highMask = JbController::getGpioHighMask(boardGpio);
+    //level is written under the lock, so tick can't override it with a stale one
+    portENTER_CRITICAL(&this->mutex_);
+    this->channels_[boardGpio].isActive = false;
+    if(level){
+        writeMasks(lowMask, 0, highMask, 0);
+    }
+    else{
+        writeMasks(0, lowMask, 0, highMask);
+    }
+    portEXIT_CRITICAL(&this->mutex_);
+}
+
+
+
+bool GpioSequencer::isPlaying(uint8_t boardGpio)
+{
+    if(boardGpio >= JbController::BOARD_GPIOS_COUNT){
+        return false;
+    }
+    portENTER_CRITICAL(&this->mutex_);
+    const bool isActive = this->channels_[boardGpio].isActive;
+    portEXIT_CRITICAL(&this->mutex_);
+    return isActive;
+}
+
+
+
+/**
+ * Moves channel to the next phase with non-zero duration.
+ * @return new pin level
+ */
+bool IRAM_ATTR GpioSequencer::nextPhase(Channel& channel)
+{
+    const Pattern& pattern = channel.pattern;
+    while(true){
+        bool level = false;
+        uint16_t duration = 0;
+        switch(channel.phase){
+            case PHASE_ON:
+                channel.phase = PHASE_OFF;
+                duration = pattern.offTicks;
+                break;
+
+            case PHASE_OFF:
+                if(++channel.pulse < pattern.pulsesCount){
+                    channel.phase = PHASE_ON;
+                    duration = pattern.onTicks;
+                    level = true;
+                }
+                else{
+                    channel.phase = PHASE_PAUSE;
+                    duration = pattern.pauseTicks;
+                }
+                break;
+
+            default:
+                channel.pulse = 0;
+                channel.repeat++;
+                if(pattern.repeatsCount && (channel.repeat >= pattern.repeatsCount)){
+                    channel.isActive = false;
+                    return false;
+                }
+                channel.phase = PHASE_ON;
+                duration = pattern.onTicks;
+                level = true;
+                break;
+        }
+        if(duration){
+            channel.remainingTicks = duration;
+            return level;
+        }
+    }
+}
+
+
+
+void IRAM_ATTR GpioSequencer::tick()
+{
+    uint32_t lowOnMask = 0;
+    uint32_t lowOffMask = 0;
+    uint32_t highOnMask = 0;
+    uint32_t highOffMask = 0;
+    bool hasActiveChannels = false;
+    portENTER_CRITICAL_ISR(&this->mutex_);
+    for(auto& channel : this->channels_){
+        if(!channel.isActive){
+            continue;
+        }
+        if(--channel.remainingTicks != 0){
+            hasActiveChannels = true;
+            continue;
+        }
+        if(nextPhase(channel)){
+            lowOnMask |= channel.lowMask;
+            highOnMask |= channel.highMask;
+        }
+        else{
+            lowOffMask |= channel.lowMask;
+            highOffMask |= channel.highMask;
+        }
+        hasActiveChannels |= channel.isActive;
+    }
+    writeMasks(lowOnMask, lowOffMask, highOnMask, highOffMask);
+    if(!hasActiveChannels){
+        this->isTimerRunning_ = false;
+        this->timer_.stopFromIsr();
+    }
+    portEXIT_CRITICAL_ISR(&this->mutex_);
+}
+
+
+
+void IRAM_ATTR GpioSequencer::writeMasks(uint32_t lowOnMask, uint32_t lowOffMask,
+        uint32_t highOnMask, uint32_t highOffMask)
+{
+    if(lowOnMask){
+        GPIO.out_w1ts = lowOnMask;
+    }
+    if(lowOffMask){
+        GPIO.out_w1tc = lowOffMask;
+    }
+    if(highOnMask){
+        GPIO.out1_w1ts.val = highOnMask;
+    }
+    if(highOffMask){
+        GPIO.out1_w1tc.val = highOffMask;
+    }
+}
+
+#endif
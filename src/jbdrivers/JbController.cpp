@@ -28,7 +28,15 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include <cstring>
+#include <mutex>
 #include "jbdrivers/JbController.hpp"
+#include "esp_flash.h"
+#include "jbdrivers/BootTiming.hpp"
+#if CONFIG_JBCONTROLLER_BULK_GPIO_INIT
+#include "soc/gpio_periph.h"
+#include "soc/gpio_sig_map.h"
+#include "esp32/rom/gpio.h"
+#endif
 
 namespace jblib
 {
@@ -37,14 +45,58 @@ namespace jbdrivers
 
 using namespace jbkernel;
 
-const BoardGpio_t JbController::boardGpios_[] = JBCONTROLLER_BOARD_GPIOS;
-char* JbController::serial_ = nullptr;
+constexpr BoardGpio_t JbController::boardGpios_[];
+JbController::Identity_t JbController::identity_{};
+static std::once_flag identityFlag;
+static portMUX_TYPE gpioTglMutex = portMUX_INITIALIZER_UNLOCKED;
+
+template<size_t... INDICES> struct IndexSequence {};
+template<size_t N, size_t... INDICES> struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, INDICES...> {};
+template<size_t... INDICES> struct MakeIndexSequence<0, INDICES...> {typedef IndexSequence<INDICES...> Type;};
+
+struct GpioMasks
+{
+    uint32_t low;
+    uint32_t high;
+};
+
+/// Register masks of every board GPIO, built at compile time
+template<typename SEQUENCE> struct GpioMasksTable;
+template<size_t... INDICES> struct GpioMasksTable<IndexSequence<INDICES...>>
+{
+    static constexpr GpioMasks masks[sizeof...(INDICES)] = {
+            {JbController::getGpioLowMask(INDICES), JbController::getGpioHighMask(INDICES)}...};
+};
+template<size_t... INDICES>
+constexpr GpioMasks GpioMasksTable<IndexSequence<INDICES...>>::masks[sizeof...(INDICES)];
+
+typedef GpioMasksTable<MakeIndexSequence<JbController::BOARD_GPIOS_COUNT>::Type> BoardGpioMasks;
+
+
+
+static inline GpioMasks getIndicesMasks(uint64_t indices)
+{
+    GpioMasks masks{0, 0};
+    while(indices){
+        const uint32_t index = __builtin_ctzll(indices);
+        if(index >= JbController::BOARD_GPIOS_COUNT){
+            break;
+        }
+        masks.low |= BoardGpioMasks::masks[index].low;
+        masks.high |= BoardGpioMasks::masks[index].high;
+        indices &= indices - 1;
+    }
+    return masks;
+}
 
 
 void JbController::initialize()
 {
 	static bool isInitialized = false;
 	if(!isInitialized) {
+        #if CONFIG_JBCONTROLLER_BULK_GPIO_INIT
+        initializeGpiosBulk();
+        #else
         for(auto & boardGpio : boardGpios_) {
             if(boardGpio.pin != GPIO_NUM_NC){
                 gpio_pad_select_gpio(boardGpio.pin);
@@ -55,72 +107,157 @@ void JbController::initialize()
                 }
             }
         }
+        #endif
 		isInitialized = true;
+        JB_BOOT_MARK("JbController GPIO");
 	}
+    getIdentity();
 }
 
 
 
-void JbController::gpioOn(uint8_t number)
+#if CONFIG_JBCONTROLLER_BULK_GPIO_INIT
+/**
+ * Levels and output enables of all board GPIOs are written by one register access per bank,
+ * outputs are driven low before they are enabled. Pad and matrix setup is per pin,
+ * but without driver locking. Pulls still go through driver, which handles RTC pads.
+ */
+void JbController::initializeGpiosBulk()
 {
-    if(boardGpios_[number].pin != GPIO_NUM_NC){
-        gpio_set_level(boardGpios_[number].pin, 1);
+    writeMasks<getDirectionLowMask(true), getDirectionHighMask(true)>(GPIO.out_w1tc, GPIO.out1_w1tc.val);
+    for(auto & boardGpio : boardGpios_) {
+        if(boardGpio.pin == GPIO_NUM_NC){
+            continue;
+        }
+        const auto pin = static_cast<uint32_t>(boardGpio.pin);
+        PIN_FUNC_SELECT(GPIO_PIN_MUX_REG[pin], PIN_FUNC_GPIO);
+        if((boardGpio.direction == GPIO_MODE_INPUT) || (boardGpio.direction == GPIO_MODE_INPUT_OUTPUT) ||
+                (boardGpio.direction == GPIO_MODE_INPUT_OUTPUT_OD)){
+            PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[pin]);
+        }
+        else{
+            PIN_INPUT_DISABLE(GPIO_PIN_MUX_REG[pin]);
+        }
+        if((boardGpio.direction != GPIO_MODE_INPUT) && (boardGpio.direction != GPIO_MODE_DISABLE)){
+            GPIO.pin[pin].pad_driver = ((boardGpio.direction == GPIO_MODE_OUTPUT_OD) ||
+                    (boardGpio.direction == GPIO_MODE_INPUT_OUTPUT_OD)) ? 1 : 0;
+            gpio_matrix_out(pin, SIG_GPIO_OUT_IDX, false, false);
+        }
+        gpio_set_pull_mode(boardGpio.pin, boardGpio.pullMode);
     }
+    writeMasks<getDirectionLowMask(false), getDirectionHighMask(false)>(GPIO.enable_w1tc, GPIO.enable1_w1tc.val);
+    writeMasks<getDirectionLowMask(true), getDirectionHighMask(true)>(GPIO.enable_w1ts, GPIO.enable1_w1ts.val);
 }
+#endif
 
 
 
-void JbController::gpioOff(uint8_t number)
+static inline void writeGpioMasks(const GpioMasks& masks, volatile uint32_t& lowRegister,
+        volatile uint32_t& highRegister)
 {
-    if(boardGpios_[number].pin != GPIO_NUM_NC){
-        gpio_set_level(boardGpios_[number].pin, 0);
+    if(masks.low){
+        lowRegister = masks.low;
+    }
+    if(masks.high){
+        highRegister = masks.high;
     }
 }
 
 
 
-void JbController::gpioTgl(uint8_t number)
+static void toggleMasks(const GpioMasks& masks)
 {
-    if(boardGpios_[number].pin == GPIO_NUM_NC){
-        return;
+    portENTER_CRITICAL_SAFE(&gpioTglMutex);
+    if(masks.low){
+        GPIO.out = GPIO.out ^ masks.low;
+    }
+    if(masks.high){
+        GPIO.out1.val = GPIO.out1.val ^ masks.high;
     }
+    portEXIT_CRITICAL_SAFE(&gpioTglMutex);
+}
+
 
-    bool isOn = false;
-    if (boardGpios_[number].pin < 32) {
-        isOn = (GPIO.out >> boardGpios_[number].pin) & 1U;
-    } else {
-        isOn = (GPIO.out1.data >> boardGpios_[number].pin) & 1U;
+
+void JbController::gpioOn(uint8_t number)
+{
+    if(number < BOARD_GPIOS_COUNT){
+        writeGpioMasks(BoardGpioMasks::masks[number], GPIO.out_w1ts, GPIO.out1_w1ts.val);
     }
+}
+
 
-    if(isOn){
-        JbController::gpioOff(number);
+
+void JbController::gpioOff(uint8_t number)
+{
+    if(number < BOARD_GPIOS_COUNT){
+        writeGpioMasks(BoardGpioMasks::masks[number], GPIO.out_w1tc, GPIO.out1_w1tc.val);
     }
-    else{
-        JbController::gpioOn(number);
+}
+
+
+
+void JbController::gpioTgl(uint8_t number)
+{
+    if(number < BOARD_GPIOS_COUNT){
+        toggleMasks(BoardGpioMasks::masks[number]);
     }
 }
 
 
+
+void JbController::gpioSetOn(uint64_t indices)
+{
+    writeGpioMasks(getIndicesMasks(indices), GPIO.out_w1ts, GPIO.out1_w1ts.val);
+}
+
+
+
+void JbController::gpioSetOff(uint64_t indices)
+{
+    writeGpioMasks(getIndicesMasks(indices), GPIO.out_w1tc, GPIO.out1_w1tc.val);
+}
+
+
+
+void JbController::gpioSetTgl(uint64_t indices)
+{
+    toggleMasks(getIndicesMasks(indices));
+}
+
+
+
 bool JbController::getGpio(uint8_t number)
 {
-    return (boardGpios_[number].pin != GPIO_NUM_NC) ? gpio_get_level(boardGpios_[number].pin) : false;
+    return ((number < BOARD_GPIOS_COUNT) && (boardGpios_[number].pin != GPIO_NUM_NC)) ?
+            gpio_get_level(boardGpios_[number].pin) : false;
 }
 
 
-char* JbController::getSerial()
+const JbController::Identity_t& JbController::getIdentity()
 {
-    if(!serial_){
-        serial_ = (char*)malloc_s(JBCONTROLLER_SERIAL_MAX_LENGTH);
-        if(serial_){
-            memset(serial_, 0, JBCONTROLLER_SERIAL_MAX_LENGTH);
-            uint8_t mac[6];
-            esp_efuse_mac_get_default(mac);
-            snprintf(serial_, JBCONTROLLER_SERIAL_MAX_LENGTH,
-                     "%02x%02x-%02x%02x-%02x%02x",
-                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        }
+    std::call_once(identityFlag, readIdentity);
+    return identity_;
+}
+
+
+
+void JbController::readIdentity()
+{
+    esp_efuse_mac_get_default(identity_.mac);
+    const uint8_t* mac = identity_.mac;
+    snprintf(identity_.serial, SERIAL_LENGTH, "%02x%02x-%02x%02x-%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(identity_.macString, MAC_STRING_LENGTH, "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    esp_chip_info_t chipInfo{};
+    esp_chip_info(&chipInfo);
+    identity_.chipRevision = chipInfo.revision;
+    identity_.coresCount = chipInfo.cores;
+    if(esp_flash_read_id(nullptr, &identity_.flashId) != ESP_OK){
+        ESP_LOGE(logTag_, "Read flash ID error");
     }
-    return serial_;
+    esp_flash_get_size(nullptr, &identity_.flashSize);
 }
 
 }
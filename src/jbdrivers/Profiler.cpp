@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief Profiler class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "jbdrivers/Profiler.hpp"
+
+#if CONFIG_PROFILER_ENABLE
+
+using namespace ::jblib::jbdrivers;
+
+ProfilerRing<Profiler::RING_SIZE> Profiler::rings_[portNUM_PROCESSORS];
+
+
+
+size_t Profiler::collect(ProfilerAggregator& aggregator)
+{
+    size_t count = 0;
+    for(auto& ring : rings_){
+        count += ring.drain(aggregator);
+    }
+    return count;
+}
+
+
+
+uint32_t Profiler::getDroppedCount()
+{
+    uint32_t count = 0;
+    for(const auto& ring : rings_){
+        count += ring.getDroppedCount();
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Profiler Aggregator class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <algorithm>
+#include "jbdrivers/ProfilerAggregator.hpp"
+
+using namespace ::jblib::jbdrivers;
+
+
+
+ProfilerAggregator::ProfilerAggregator(uint16_t probesCount, uint16_t samplesPerProbe) :
+        samplesPerProbe_(samplesPerProbe ? samplesPerProbe : 1), probes_(probesCount),
+        samples_(static_cast<size_t>(probesCount) * (samplesPerProbe ? samplesPerProbe : 1))
+{
+    this->reset();
+}
+
+
+
+void ProfilerAggregator::add(const ProfilerRecord_t& record)
+{
+    if(record.probeId >= this->probes_.size()){
+        return;
+    }
+    const uint32_t duration = record.endTicks - record.beginTicks;
+    Probe& probe = this->probes_[record.probeId];
+    this->samples_[(static_cast<size_t>(record.probeId) * this->samplesPerProbe_) +
+            (probe.count % this->samplesPerProbe_)] = duration;
+    probe.count++;
+    probe.sum += duration;
+    if(duration < probe.min){
+        probe.min = duration;
+    }
+    if(duration > probe.max){
+        probe.max = duration;
+    }
+}
+
+
+
+ProfilerAggregator::Statistics_t ProfilerAggregator::getStatistics(uint16_t probeId) const
+{
+    Statistics_t statistics;
+    if((probeId >= this->probes_.size()) || !this->probes_[probeId].count){
+        return statistics;
+    }
+    const Probe& probe = this->probes_[probeId];
+    statistics.count = probe.count;
+    statistics.min = probe.min;
+    statistics.max = probe.max;
+    statistics.average = static_cast<uint32_t>(probe.sum / probe.count);
+    const size_t samplesCount = std::min<size_t>(probe.count, this->samplesPerProbe_);
+    const auto first = this->samples_.begin() + (static_cast<size_t>(probeId) * this->samplesPerProbe_);
+    std::vector<uint32_t> samples(first, first + samplesCount);
+    const auto percentile = samples.begin() + ((samplesCount * 99) / 100);
+    std::nth_element(samples.begin(), percentile, samples.end());
+    statistics.p99 = *percentile;
+    return statistics;
+}
+
+
+
+void ProfilerAggregator::reset()
+{
+    for(auto& probe : this->probes_){
+        probe = Probe{0, UINT32_MAX, 0, 0};
+    }
+}
@@ -0,0 +1,360 @@
+/**
+ * @file
+ * @brief Soft Timer Multiplexer class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "jbkernel/jb_common.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
+
+#include <stdexcept>
+#include <esp_pthread.h>
+#include "jbdrivers/SoftTimerMultiplexer.hpp"
+
+using namespace ::jblib::jbdrivers;
+
+
+
+SoftTimerMultiplexer::SoftTimerMultiplexer(VoidTimer& timer, bool isDeferredDispatchEnabled) : timer_(timer)
+{
+    vPortCPUInitializeMutex(&this->mutex_);
+    if(isDeferredDispatchEnabled){
+        this->deferredSemaphore_ = xSemaphoreCreateBinary();
+        if(!this->deferredSemaphore_){
+            #if CONFIG_COMPILER_CXX_EXCEPTIONS
+            throw std::bad_alloc();
+            #else
+            ESP_LOGE(logTag_, "Create deferred semaphore error");
+            #endif
+        }
+        else{
+            auto cfg = esp_pthread_get_default_config();
+            cfg.thread_name = logTag_;
+            cfg.stack_size = CONFIG_SOFT_TIMER_TASK_STACK_SIZE;
+            cfg.prio = CONFIG_SOFT_TIMER_TASK_PRIORITY;
+            esp_pthread_set_cfg(&cfg);
+            this->isRunning_ = true;
+            this->deferredThread_ = std::thread(&SoftTimerMultiplexer::deferredDispatcher, this);
+        }
+    }
+    this->timer_.initializeOneShot();
+    this->timer_.addIsrCallback([this](void*, void*){
+        this->onAlarm();
+    });
+    this->timer_.start();
+}
+
+
+
+SoftTimerMultiplexer::~SoftTimerMultiplexer()
+{
+    this->timer_.stop();
+    this->timer_.deleteIsrCallback();
+    this->timer_.deinitialize();
+    if(this->isRunning_){
+        this->isRunning_ = false;
+        xSemaphoreGive(this->deferredSemaphore_);
+        this->deferredThread_.join();
+    }
+    if(this->deferredSemaphore_){
+        vSemaphoreDelete(this->deferredSemaphore_);
+    }
+}
+
+
+
+void SoftTimerMultiplexer::start(SoftTimer& timer, uint64_t delayUs, uint64_t periodUs)
+{
+    this->startTicks(timer, this->timer_.nsToTicks(delayUs * 1000), this->timer_.nsToTicks(periodUs * 1000));
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::startTicks(SoftTimer& timer, uint64_t delayTicks, uint64_t periodTicks)
+{
+    constexpr uint64_t quantumTicks = 1ULL << RESOLUTION_SHIFT;
+    portENTER_CRITICAL_SAFE(&this->mutex_);
+    this->unlink(timer);
+    if(timer.dispatchState_ == SoftTimer::DISPATCH_PENDING){
+        timer.dispatchState_ = SoftTimer::DISPATCH_CANCELLED;
+    }
+    const uint64_t current = this->getCurrentQuantum();
+    if(this->wheelCount_ == 0){
+        this->now_ = current;   //nothing to cascade, skip idle time
+    }
+    timer.expires_ = current + ((delayTicks + quantumTicks - 1) >> RESOLUTION_SHIFT);
+    if(timer.expires_ <= this->now_){
+        timer.expires_ = this->now_ + 1;  //quantum now_ is already processed
+    }
+    timer.period_ = (periodTicks + quantumTicks - 1) >> RESOLUTION_SHIFT;
+    timer.overrunsCount_ = 0;
+    this->insert(timer);
+    if(this->getNextEvent() < this->alarm_){
+        this->updateAlarm();
+    }
+    portEXIT_CRITICAL_SAFE(&this->mutex_);
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::cancel(SoftTimer& timer)
+{
+    portENTER_CRITICAL_SAFE(&this->mutex_);
+    this->unlink(timer);
+    if(timer.dispatchState_ == SoftTimer::DISPATCH_PENDING){
+        timer.dispatchState_ = SoftTimer::DISPATCH_CANCELLED;
+    }
+    portEXIT_CRITICAL_SAFE(&this->mutex_);
+}
+
+
+
+bool SoftTimerMultiplexer::isActive(const SoftTimer& timer)
+{
+    portENTER_CRITICAL(&this->mutex_);
+    const bool isActive = (timer.list_ != nullptr) || (timer.dispatchState_ == SoftTimer::DISPATCH_PENDING);
+    portEXIT_CRITICAL(&this->mutex_);
+    return isActive;
+}
+
+
+
+uint64_t IRAM_ATTR SoftTimerMultiplexer::getCurrentQuantum()
+{
+    return timer_group_get_counter_value_in_isr(this->timer_.timerGroup_, this->timer_.timerIdx_) >>
+            RESOLUTION_SHIFT;
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::unlink(SoftTimer& timer)
+{
+    if(!timer.list_){
+        return;
+    }
+    if(timer.previous_){
+        timer.previous_->next_ = timer.next_;
+    }
+    else{
+        *timer.list_ = timer.next_;
+        if(!timer.next_){
+            this->occupancy_[timer.level_] &= ~(1ULL << timer.slot_);
+        }
+    }
+    if(timer.next_){
+        timer.next_->previous_ = timer.previous_;
+    }
+    timer.next_ = nullptr;
+    timer.previous_ = nullptr;
+    timer.list_ = nullptr;
+    this->wheelCount_--;
+}
+
+
+
+/**
+ * Level is chosen by distance from now_, slot by expiration time bits of that level.
+ * Late periodic timer is placed to the next quantum, expires_ is kept to stay in phase.
+ */
+void IRAM_ATTR SoftTimerMultiplexer::insert(SoftTimer& timer)
+{
+    uint64_t delta = (timer.expires_ > this->now_) ? (timer.expires_ - this->now_) : 1;
+    if(delta > MAX_DELTA){
+        delta = MAX_DELTA;  //re-inserted on cascade until it is close enough
+    }
+    const uint64_t target = this->now_ + delta;
+    uint32_t level = 0;
+    while((level < (LEVELS - 1)) && (delta >= (1ULL << (SLOT_BITS * (level + 1))))){
+        level++;
+    }
+    const auto slot = static_cast<uint8_t>((target >> (SLOT_BITS * level)) & (SLOTS - 1));
+    SoftTimer*& list = this->wheel_[level][slot];
+    timer.previous_ = nullptr;
+    timer.next_ = list;
+    if(list){
+        list->previous_ = &timer;
+    }
+    list = &timer;
+    timer.list_ = &list;
+    timer.level_ = static_cast<uint8_t>(level);
+    timer.slot_ = slot;
+    this->occupancy_[level] |= 1ULL << slot;
+    this->wheelCount_++;
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::expire(SoftTimer& timer)
+{
+    if(timer.period_){
+        timer.expires_ += timer.period_;   //drift free, catches up by firing on the next quanta if late
+        this->insert(timer);
+    }
+    if(timer.dispatchState_ == SoftTimer::DISPATCH_PENDING){
+        timer.overrunsCount_++;
+        return;
+    }
+    if(timer.dispatchState_ == SoftTimer::DISPATCH_NONE){
+        SoftTimer*& stack = (timer.isDeferred_ && this->deferredSemaphore_) ? this->deferred_ : this->expired_;
+        timer.dispatchNext_ = stack;
+        stack = &timer;
+    }
+    timer.dispatchState_ = SoftTimer::DISPATCH_PENDING;
+}
+
+
+
+/// Nearest quantum when level 0 slot expires or higher level slot must be cascaded
+uint64_t IRAM_ATTR SoftTimerMultiplexer::getNextEvent() const
+{
+    uint64_t nextEvent = UINT64_MAX;
+    for(uint32_t level = 0; level < LEVELS; level++){
+        const uint64_t occupancy = this->occupancy_[level];
+        if(!occupancy){
+            continue;
+        }
+        const uint32_t shift = SLOT_BITS * level;
+        const uint32_t rotation = static_cast<uint32_t>((this->now_ >> shift) + 1) & (SLOTS - 1);
+        const uint64_t rotated = rotation ? ((occupancy >> rotation) | (occupancy << (SLOTS - rotation))) : occupancy;
+        const uint64_t event = ((this->now_ >> shift) + __builtin_ctzll(rotated) + 1) << shift;
+        if(event < nextEvent){
+            nextEvent = event;
+        }
+    }
+    return nextEvent;
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::advance(uint64_t quantum)
+{
+    while(true){
+        const uint64_t event = this->getNextEvent();
+        if(event > quantum){
+            if(quantum > this->now_){
+                this->now_ = quantum;
+            }
+            return;
+        }
+        this->now_ = event;
+        for(uint32_t level = LEVELS - 1; level > 0; level--){
+            const uint32_t shift = SLOT_BITS * level;
+            if(event & ((1ULL << shift) - 1)){
+                continue;
+            }
+            SoftTimer*& list = this->wheel_[level][(event >> shift) & (SLOTS - 1)];
+            while(list){
+                SoftTimer& timer = *list;
+                this->unlink(timer);
+                //timer due exactly at this quantum expires now instead of landing in the next one
+                if(timer.expires_ <= this->now_){
+                    this->expire(timer);
+                }
+                else{
+                    this->insert(timer);
+                }
+            }
+        }
+        SoftTimer*& list = this->wheel_[0][event & (SLOTS - 1)];
+        while(list){
+            SoftTimer& timer = *list;
+            this->unlink(timer);
+            this->expire(timer);
+        }
+    }
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::updateAlarm()
+{
+    this->alarm_ = this->getNextEvent();
+    if(this->alarm_ != UINT64_MAX){
+        this->timer_.setAlarm64(this->alarm_ << RESOLUTION_SHIFT);
+    }
+}
+
+
+
+void IRAM_ATTR SoftTimerMultiplexer::onAlarm()
+{
+    portENTER_CRITICAL_ISR(&this->mutex_);
+    this->advance(this->getCurrentQuantum());
+    this->updateAlarm();
+    const bool isDeferredPending = (this->deferred_ != nullptr);
+    portEXIT_CRITICAL_ISR(&this->mutex_);
+    while(this->dispatch(this->expired_)){
+
+    }
+    if(isDeferredPending){
+        BaseType_t isAwake = 0;
+        xSemaphoreGiveFromISR(this->deferredSemaphore_, &isAwake);
+        if(isAwake){
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+
+
+/// Pops one timer from dispatch stack and calls it if it wasn't cancelled. @return false if stack is empty
+bool IRAM_ATTR SoftTimerMultiplexer::dispatch(SoftTimer*& stack)
+{
+    portENTER_CRITICAL_SAFE(&this->mutex_);
+    SoftTimer* timer = stack;
+    if(!timer){
+        portEXIT_CRITICAL_SAFE(&this->mutex_);
+        return false;
+    }
+    stack = timer->dispatchNext_;
+    timer->dispatchNext_ = nullptr;
+    const bool isPending = (timer->dispatchState_ == SoftTimer::DISPATCH_PENDING);
+    timer->dispatchState_ = SoftTimer::DISPATCH_NONE;
+    const IsrDelegate callback = timer->callback_;
+    void* parameter = timer->parameter_;
+    portEXIT_CRITICAL_SAFE(&this->mutex_);
+    if(isPending && callback){
+        callback(timer, parameter);
+    }
+    return true;
+}
+
+
+
+void SoftTimerMultiplexer::deferredDispatcher()
+{
+    while(true){
+        xSemaphoreTake(this->deferredSemaphore_, portMAX_DELAY);
+        if(!this->isRunning_){
+            return;
+        }
+        while(this->dispatch(this->deferred_)){
+
+        }
+    }
+}
+
+#endif
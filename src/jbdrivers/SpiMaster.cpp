@@ -28,44 +28,214 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "jbdrivers/SpiMaster.hpp"
+#include "jbdrivers/Profiler.hpp"
+#include "jbdrivers/BootTiming.hpp"
 #include <stdexcept>
 #include "esp_intr_alloc.h"
+#include "soc/soc.h"
+#if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+#include <esp_pthread.h>
+#include <cstring>
+#include <algorithm>
+#endif
 
 using namespace ::jblib::jbdrivers;
 
-SpiMaster::SpiMaster(const spi_bus_config_t& configuration, spi_host_device_t number, bool useDma) : number_(number)
+constexpr int SpiMaster::IOMUX_PINS[][6];
+constexpr int SpiMaster::IOMUX_HOSTS_COUNT;
+
+#if CONFIG_SPI_MASTER_TRACE_ENABLE
+//transactions in flight are matched to devices here, user field stays caller's
+static constexpr size_t TRACE_SLOTS_COUNT = 8;
+static struct {
+    const spi_transaction_t* transaction;
+    SpiMaster::Device* device;
+} traceSlots[TRACE_SLOTS_COUNT];
+static portMUX_TYPE traceSlotsMutex = portMUX_INITIALIZER_UNLOCKED;
+
+
+
+/// Returns -1 if all slots are busy, transaction is then traced by caller side time
+static int claimTraceSlot(const spi_transaction_t& transaction, SpiMaster::Device* device)
+{
+    int slot = -1;
+    portENTER_CRITICAL(&traceSlotsMutex);
+    for(size_t i = 0; i < TRACE_SLOTS_COUNT; i++){
+        if(!traceSlots[i].transaction){
+            traceSlots[i].transaction = &transaction;
+            traceSlots[i].device = device;
+            slot = static_cast<int>(i);
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&traceSlotsMutex);
+    return slot;
+}
+
+
+
+static void releaseTraceSlot(int slot)
 {
-    auto ret = spi_bus_initialize(number, &configuration, useDma? number : 0);
+    if(slot < 0){
+        return;
+    }
+    portENTER_CRITICAL(&traceSlotsMutex);
+    traceSlots[slot].transaction = nullptr;
+    traceSlots[slot].device = nullptr;
+    portEXIT_CRITICAL(&traceSlotsMutex);
+}
+
+
+
+static IRAM_ATTR SpiMaster::Device* findTracedDevice(const spi_transaction_t* transaction)
+{
+    SpiMaster::Device* device = nullptr;
+    portENTER_CRITICAL_ISR(&traceSlotsMutex);
+    for(size_t i = 0; i < TRACE_SLOTS_COUNT; i++){
+        if(traceSlots[i].transaction == transaction){
+            device = traceSlots[i].device;
+            break;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&traceSlotsMutex);
+    return device;
+}
+#endif
+
+
+
+SpiMaster::SpiMaster(const spi_bus_config_t& configuration, spi_host_device_t number, bool useDma,
+        bool isLazyStart) : number_(number), busConfiguration_(configuration), useDma_(useDma)
+{
+    if((number < 0) || (number >= IOMUX_HOSTS_COUNT)){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::invalid_argument("Wrong SPI host number");
+        #else
+        ESP_LOGE(logTag_, "Wrong SPI host number %i", number);
+        return;
+        #endif
+    }
+    const auto& pins = IOMUX_PINS[number];
+    this->isIomux_ = (configuration.flags & SPICOMMON_BUSFLAG_IOMUX_PINS) ||
+            ((configuration.mosi_io_num == pins[0] || configuration.mosi_io_num < 0) &&
+            (configuration.miso_io_num == pins[1] || configuration.miso_io_num < 0) &&
+            (configuration.sclk_io_num == pins[2]));
+    if(!isLazyStart){
+        this->start();
+    }
+}
+
+
+
+void SpiMaster::start()
+{
+    std::lock_guard<std::mutex> lock(this->startMutex_);
+    if(this->isStarted_){
+        return;
+    }
+    auto ret = spi_bus_initialize(this->number_, &this->busConfiguration_, this->useDma_ ? this->number_ : 0);
     if(ret != ESP_OK){
         #if CONFIG_COMPILER_CXX_EXCEPTIONS
         throw std::logic_error("Bus initialize error");
         #else
         ESP_LOGE(logTag_, "Bus initialize error");
+        return;
         #endif
     }
+    this->isStarted_ = true;
+    this->pendingDevices_.reverse();
+    for(auto device : this->pendingDevices_){
+        this->addStartedDevice(*device);
+    }
+    this->pendingDevices_.clear();
+    JB_BOOT_MARK("SPI bus start");
 }
 
 
 
 spi_bus_config_t SpiMaster::Device::getBusConfiguration()
 {
+    auto configuration = SpiMaster::getIomuxBusConfiguration(HSPI_HOST);
+    configuration.flags = SPICOMMON_BUSFLAG_MASTER;
+    return configuration;
+}
+
+
+
+spi_bus_config_t SpiMaster::getIomuxBusConfiguration(spi_host_device_t number, DataMode_t dataMode)
+{
+    //unknown host gets no pins, as SPI1 used by flash
+    const auto& pins = IOMUX_PINS[((number >= 0) && (number < IOMUX_HOSTS_COUNT)) ? number : 0];
     spi_bus_config_t configuration{};
-    configuration.mosi_io_num = 13;
-    configuration.miso_io_num = 12;
-    configuration.sclk_io_num = 14;
-    configuration.quadwp_io_num = -1;
-    configuration.quadhd_io_num = -1;
+    configuration.mosi_io_num = pins[0];
+    configuration.miso_io_num = pins[1];
+    configuration.sclk_io_num = pins[2];
+    configuration.quadwp_io_num = (dataMode == DATA_MODE_QUAD) ? pins[4] : -1;
+    configuration.quadhd_io_num = (dataMode == DATA_MODE_QUAD) ? pins[5] : -1;
     configuration.max_transfer_sz = 0;
-    configuration.flags = SPICOMMON_BUSFLAG_MASTER;
+    configuration.flags = SPICOMMON_BUSFLAG_MASTER | SPICOMMON_BUSFLAG_IOMUX_PINS;
+    if(dataMode == DATA_MODE_DUAL){
+        configuration.flags |= SPICOMMON_BUSFLAG_DUAL;
+    }
+    else if(dataMode == DATA_MODE_QUAD){
+        configuration.flags |= SPICOMMON_BUSFLAG_QUAD;
+    }
     configuration.intr_flags = ESP_INTR_FLAG_LOWMED;
     return configuration;
 }
 
 
 
+int SpiMaster::getMaxFullDuplexClock(int inputDelayNs, bool useIomux)
+{
+    return spi_get_freq_limit(!useIomux, inputDelayNs);
+}
+
+
+
+int SpiMaster::getTimingDummyBits(int clockSpeedHz, int inputDelayNs, bool useIomux)
+{
+    int dummyBits = 0;
+    int misoDelay = 0;
+    spi_get_timing(!useIomux, inputDelayNs,
+            spi_get_actual_clock(APB_CLK_FREQ, clockSpeedHz, 128), &dummyBits, &misoDelay);
+    return dummyBits;
+}
+
+
+
 void SpiMaster::addDevice(Device& device)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->startMutex_);
+        if(!this->isStarted_){
+            setDeviceMaster(device, this);
+            this->pendingDevices_.push_front(&device);
+            return;
+        }
+    }
+    this->addStartedDevice(device);
+}
+
+
+
+void SpiMaster::addStartedDevice(Device& device)
 {
     auto configuration = getDeviceSpiConfiguration(device);
+    if(!(configuration.flags & SPI_DEVICE_HALFDUPLEX)){
+        const int maxClock = getMaxFullDuplexClock(configuration.input_delay_ns, this->isIomux_);
+        if(configuration.clock_speed_hz > maxClock){
+            ESP_LOGW(logTag_, "Full duplex clock %i Hz is above %i Hz limit, MISO can be sampled wrong",
+                    configuration.clock_speed_hz, maxClock);
+        }
+    }
+    #if CONFIG_SPI_MASTER_TRACE_ENABLE
+    //bus time is taken when transaction is on the wires, not when it waits for the queue or bus
+    if(!configuration.pre_cb && !configuration.post_cb){
+        configuration.pre_cb = Device::tracePreCallback;
+        configuration.post_cb = Device::tracePostCallback;
+    }
+    #endif
     spi_device_handle_t handle;
     auto ret = spi_bus_add_device(this->number_, &configuration, &handle);
     if(ret != ESP_OK){
@@ -77,15 +247,45 @@ void SpiMaster::addDevice(Device& device)
         #endif
     }
     setDeviceHandle(device, handle);
+    setDeviceMaster(device, this);
     this->devicesList_.push_front(handle);
+    #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+    if(this->isSchedulerRunning_){
+        QueueHandle_t queues[PRIORITY_MAX]{};
+        for(size_t i = 0; i < PRIORITY_MAX; i++){
+            queues[i] = xQueueCreate(CONFIG_SPI_MASTER_SCHEDULER_QUEUE_SIZE, sizeof(ScheduledTransaction));
+            if(!queues[i]){
+                for(size_t j = 0; j < i; j++){
+                    vQueueDelete(queues[j]);
+                }
+                #if CONFIG_COMPILER_CXX_EXCEPTIONS
+                throw std::bad_alloc();
+                #else
+                ESP_LOGE(logTag_, "Create device queue error");
+                return;
+                #endif
+            }
+        }
+        std::lock_guard<std::mutex> lock(this->schedulerMutex_);
+        memcpy(getDeviceQueues(device), queues, sizeof(queues));
+        this->scheduledDevices_.push_back(&device);
+    }
+    #endif
 }
 
 
 
 void SpiMaster::removeDevice(const Device& device)
 {
+    {
+        std::lock_guard<std::mutex> lock(this->startMutex_);
+        this->pendingDevices_.remove(const_cast<Device*>(&device));
+    }
     spi_device_handle_t handle = getDeviceHandle(device);
     if(handle){
+        #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+        this->releaseDeviceQueues(const_cast<Device&>(device));
+        #endif
         this->devicesList_.remove(handle);
         spi_bus_remove_device(handle);
     }
@@ -93,10 +293,240 @@ void SpiMaster::removeDevice(const Device& device)
 
 
 
+esp_err_t SpiMaster::Device::transmit(spi_transaction_t& transaction, bool usePolling,
+        TransactionPriority_t priority)
+{
+    JB_PROFILE_SCOPE(PROFILER_PROBE_SPI_TRANSACTION);
+    if(!this->handle && this->master_){
+        this->master_->start();
+    }
+    #if CONFIG_SPI_MASTER_TRACE_ENABLE
+    this->busStartUs_ = 0;
+    this->busEndUs_ = 0;
+    const int traceSlot = claimTraceSlot(transaction, this);
+    #endif
+    esp_err_t result = ESP_ERR_NOT_FOUND;
+    #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+    if(this->master_){
+        result = this->master_->scheduleTransaction(*this, transaction, usePolling, priority);
+    }
+    #else
+    (void)priority;
+    #endif
+    if(result == ESP_ERR_NOT_FOUND){
+        result = usePolling ? spi_device_polling_transmit(this->handle, &transaction) :
+                spi_device_transmit(this->handle, &transaction);
+    }
+    #if CONFIG_SPI_MASTER_TRACE_ENABLE
+    releaseTraceSlot(traceSlot);
+    #endif
+    return result;
+}
+
+
+
+#if CONFIG_SPI_MASTER_TRACE_ENABLE
+void IRAM_ATTR SpiMaster::Device::tracePreCallback(spi_transaction_t* transaction)
+{
+    Device* device = findTracedDevice(transaction);
+    if(device){
+        device->busStartUs_ = esp_timer_get_time();
+    }
+}
+
+
+
+void IRAM_ATTR SpiMaster::Device::tracePostCallback(spi_transaction_t* transaction)
+{
+    Device* device = findTracedDevice(transaction);
+    if(device){
+        device->busEndUs_ = esp_timer_get_time();
+    }
+}
+
+
+
+void SpiMaster::Device::traceTransaction(const spi_transaction_t& transaction, int64_t startUs)
+{
+    int64_t endUs = esp_timer_get_time();
+    if(this->busStartUs_ && (this->busEndUs_ >= this->busStartUs_)){
+        startUs = this->busStartUs_;
+        endUs = this->busEndUs_;
+    }
+    const size_t bytesCount = (transaction.length + 7) / 8;
+    this->trace_.record(static_cast<uint32_t>(transaction.addr), transaction.cmd, bytesCount, startUs, endUs);
+    if(this->master_){
+        this->master_->trace_.record(static_cast<uint32_t>(transaction.addr), transaction.cmd,
+                bytesCount, startUs, endUs);
+    }
+}
+#endif
+
+
+
+#if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+void SpiMaster::startScheduler()
+{
+    if(this->isSchedulerRunning_){
+        return;
+    }
+    this->pendingSemaphore_ = xSemaphoreCreateCounting(UINT32_MAX, 0);
+    if(!this->pendingSemaphore_){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::bad_alloc();
+        #else
+        ESP_LOGE(logTag_, "Create pending semaphore error");
+        return;
+        #endif
+    }
+    auto cfg = esp_pthread_get_default_config();
+    cfg.thread_name = logTag_;
+    cfg.stack_size = CONFIG_SPI_MASTER_SCHEDULER_TASK_STACK_SIZE;
+    cfg.prio = CONFIG_SPI_MASTER_SCHEDULER_TASK_PRIORITY;
+    cfg.pin_to_core = CONFIG_SPI_MASTER_SCHEDULER_TASK_CORE;
+    if((cfg.pin_to_core != 0 && cfg.pin_to_core != 1) || portNUM_PROCESSORS < 2) {
+        cfg.pin_to_core = tskNO_AFFINITY;
+    }
+    esp_pthread_set_cfg(&cfg);
+    this->isSchedulerRunning_ = true;
+    this->schedulerThread_ = std::thread(&SpiMaster::dispatcher, this);
+}
+
+
+
+esp_err_t SpiMaster::scheduleTransaction(Device& device, spi_transaction_t& transaction,
+        bool usePolling, TransactionPriority_t priority)
+{
+    auto& sendersCount = getDeviceSendersCount(device);
+    QueueHandle_t queue = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(this->schedulerMutex_);
+        queue = getDeviceQueues(device)[priority];
+        if(!queue){
+            return ESP_ERR_NOT_FOUND;
+        }
+        sendersCount++;
+    }
+    esp_err_t result = ESP_FAIL;
+    StaticSemaphore_t doneSemaphoreBuffer;
+    ScheduledTransaction scheduledTransaction{};
+    scheduledTransaction.transaction = &transaction;
+    scheduledTransaction.usePolling = usePolling;
+    scheduledTransaction.result = &result;
+    scheduledTransaction.doneSemaphore = xSemaphoreCreateBinaryStatic(&doneSemaphoreBuffer);
+    if(xQueueSend(queue, &scheduledTransaction, portMAX_DELAY) != pdTRUE){
+        sendersCount--;
+        vSemaphoreDelete(scheduledTransaction.doneSemaphore);
+        return ESP_ERR_TIMEOUT;
+    }
+    //pending semaphore must outlive this give, sender is counted until it is done
+    xSemaphoreGive(this->pendingSemaphore_);
+    sendersCount--;
+    xSemaphoreTake(scheduledTransaction.doneSemaphore, portMAX_DELAY);
+    vSemaphoreDelete(scheduledTransaction.doneSemaphore);
+    return result;
+}
+
+
+
+bool SpiMaster::takeScheduledTransaction(ScheduledTransaction& scheduledTransaction, Device*& device)
+{
+    std::lock_guard<std::mutex> lock(this->schedulerMutex_);
+    const size_t devicesCount = this->scheduledDevices_.size();
+    for(int priority = PRIORITY_MAX - 1; priority >= PRIORITY_NORMAL; priority--){
+        for(size_t i = 0; i < devicesCount; i++){
+            const size_t index = (this->nextDeviceIndex_[priority] + i) % devicesCount;
+            if(xQueueReceive(getDeviceQueues(*this->scheduledDevices_[index])[priority],
+                    &scheduledTransaction, 0) == pdTRUE){
+                this->nextDeviceIndex_[priority] = index + 1;
+                device = this->scheduledDevices_[index];
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+
+void SpiMaster::dispatcher()
+{
+    ScheduledTransaction scheduledTransaction{};
+    Device* device = nullptr;
+    while(true){
+        xSemaphoreTake(this->pendingSemaphore_, portMAX_DELAY);
+        if(!this->isSchedulerRunning_){
+            return;
+        }
+        std::lock_guard<std::mutex> lock(this->dispatchMutex_);
+        if(!this->takeScheduledTransaction(scheduledTransaction, device)){
+            continue;
+        }
+        *scheduledTransaction.result = scheduledTransaction.usePolling ?
+                spi_device_polling_transmit(getDeviceHandle(*device), scheduledTransaction.transaction) :
+                spi_device_transmit(getDeviceHandle(*device), scheduledTransaction.transaction);
+        xSemaphoreGive(scheduledTransaction.doneSemaphore);
+    }
+}
+
+
+
+void SpiMaster::releaseDeviceQueues(Device& device)
+{
+    QueueHandle_t queues[PRIORITY_MAX]{};
+    {
+        //dispatcher can't be in the middle of this device transaction while both are held
+        std::lock_guard<std::mutex> dispatchLock(this->dispatchMutex_);
+        std::lock_guard<std::mutex> lock(this->schedulerMutex_);
+        auto it = std::find(this->scheduledDevices_.begin(), this->scheduledDevices_.end(), &device);
+        if(it == this->scheduledDevices_.end()){
+            return;
+        }
+        this->scheduledDevices_.erase(it);
+        memcpy(queues, getDeviceQueues(device), sizeof(queues));
+        memset(getDeviceQueues(device), 0, sizeof(queues));
+    }
+    //callers that got queue before detach may still be sending, drain until they are gone
+    auto& sendersCount = getDeviceSendersCount(device);
+    ScheduledTransaction scheduledTransaction{};
+    while(true){
+        const bool hasSenders = sendersCount != 0;
+        for(size_t i = 0; i < PRIORITY_MAX; i++){
+            while(xQueueReceive(queues[i], &scheduledTransaction, 0) == pdTRUE){
+                *scheduledTransaction.result = ESP_ERR_INVALID_STATE;
+                xSemaphoreGive(scheduledTransaction.doneSemaphore);
+            }
+        }
+        if(!hasSenders){
+            break;
+        }
+        vTaskDelay(1);
+    }
+    for(size_t i = 0; i < PRIORITY_MAX; i++){
+        vQueueDelete(queues[i]);
+    }
+}
+#endif
+
+
+
 SpiMaster::~SpiMaster()
 {
+    #if CONFIG_SPI_MASTER_SCHEDULER_ENABLE
+    if(this->isSchedulerRunning_){
+        this->isSchedulerRunning_ = false;
+        xSemaphoreGive(this->pendingSemaphore_);
+        this->schedulerThread_.join();
+        while(!this->scheduledDevices_.empty()){
+            this->releaseDeviceQueues(*this->scheduledDevices_.back());
+        }
+        vSemaphoreDelete(this->pendingSemaphore_);
+    }
+    #endif
     for(auto handle : this->devicesList_){
         spi_bus_remove_device(handle);
     }
-    spi_bus_free(this->number_);
+    if(this->isStarted_){
+        spi_bus_free(this->number_);
+    }
 }
@@ -0,0 +1,252 @@
+/**
+ * @file
+ * @brief SPI Sampling Pipeline class realization
+ *
+ *
+ * @note
+ * Copyright © 2021 Evgeniy Ivanov. Contacts: <strelok1290@gmail.com>
+ * All rights reserved.
+ * @note
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * @note
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @note
+ * This file is a part of JB_Lib.
+ */
+
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "jbkernel/jb_common.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
+
+#include <cstring>
+#include <stdexcept>
+#include "jbdrivers/SpiSamplingPipeline.hpp"
+
+using namespace ::jblib::jbdrivers;
+
+
+
+SpiSamplingPipeline::SpiSamplingPipeline(SpiMaster::Device& device, VoidTimer& timer,
+        const Configuration& config) : device_(device), timer_(timer), config_(config)
+{
+    vPortCPUInitializeMutex(&this->mutex_);
+    if((this->config_.sampleSize == 0) || (this->config_.sampleSize > (DATA_WORDS * 4)) ||
+            (this->config_.samplesPerBlock == 0) || (this->config_.blocksCount < 2) ||
+            (this->config_.blocksCount & (this->config_.blocksCount - 1))){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::invalid_argument("Wrong sampling pipeline configuration");
+        #else
+        ESP_LOGE(logTag_, "Wrong sampling pipeline configuration");
+        return;
+        #endif
+    }
+    this->blocks_ = std::unique_ptr<uint8_t[]>(new uint8_t[this->getBlockSize() * this->config_.blocksCount]);
+    this->firstSamples_ = std::unique_ptr<uint64_t[]>(new uint64_t[this->config_.blocksCount]);
+    this->blockSemaphore_ = xSemaphoreCreateBinary();
+    if(!this->blockSemaphore_){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
+        throw std::bad_alloc();
+        #else
+        ESP_LOGE(logTag_, "Create block semaphore error");
+        #endif
+    }
+}
+
+
+
+SpiSamplingPipeline::~SpiSamplingPipeline()
+{
+    this->stop();
+    if(this->blockSemaphore_){
+        vSemaphoreDelete(this->blockSemaphore_);
+    }
+}
+
+
+
+void SpiSamplingPipeline::start(const spi_transaction_t& transaction)
+{
+    if(this->isRunning_ || !this->blocks_){
+        return;
+    }
+    const size_t txBytes = (transaction.length + 7) / 8;
+    const size_t rxBytes = ((transaction.rxlength ? transaction.rxlength : transaction.length) + 7) / 8;
+    SpiMaster* master = SpiMaster::getDeviceMaster(this->device_);
+    //DMA transaction can't be restarted by cmd.usr only, its descriptors must be reloaded
+    if(!master || master->useDma_ || (master->number_ == SPI1_HOST) || (txBytes > (DATA_WORDS * 4)) ||
+            (rxBytes > (DATA_WORDS * 4)) || (rxBytes < this->config_.sampleSize)){
+        ESP_LOGE(logTag_, "Transaction can't be sampled by hardware restart");
+        return;
+    }
+    master->start();
+    this->hw_ = (master->number_ == SPI2_HOST) ? &SPI2 : &SPI3;
+    this->transaction_ = transaction;
+    const auto txData = (transaction.flags & SPI_TRANS_USE_TXDATA) ? transaction.tx_data :
+            reinterpret_cast<const uint8_t*>(transaction.tx_buffer);
+    std::memset(this->txWords_, 0, sizeof(this->txWords_));
+    if(txData){
+        std::memcpy(this->txWords_, txData, txBytes);
+    }
+    this->txWordsCount_ = (txBytes + 3) / 4;
+    this->transaction_.flags &= ~SPI_TRANS_USE_RXDATA;
+    this->transaction_.rx_buffer = this->rxWords_;
+    this->transaction_.flags &= ~SPI_TRANS_USE_TXDATA;
+    this->transaction_.tx_buffer = this->txWords_;
+
+    spi_device_handle_t handle = SpiMaster::getDeviceHandle(this->device_);
+    auto ret = spi_device_acquire_bus(handle, portMAX_DELAY);
+    if(ret != ESP_OK){
+        ESP_LOGE(logTag_, "Acquire bus error %i", ret);
+        return;
+    }
+    //registers keep this transaction, ISR only reloads data and restarts it
+    ret = spi_device_polling_transmit(handle, &this->transaction_);
+    if(ret != ESP_OK){
+        ESP_LOGE(logTag_, "Program transaction error %i", ret);
+        spi_device_release_bus(handle);
+        return;
+    }
+    portENTER_CRITICAL(&this->mutex_);
+    this->statistics_ = Statistics_t();
+    this->writeBlock_.store(0, std::memory_order_relaxed);
+    this->readBlock_.store(0, std::memory_order_relaxed);
+    this->sampleIndex_ = 0;
+    this->isTransactionPending_ = false;
+    portEXIT_CRITICAL(&this->mutex_);
+    this->timer_.initialize(this->config_.periodUs);
+    this->timer_.addIsrCallback([this](void*, void*){
+        this->onTick();
+    });
+    this->isRunning_ = true;
+    this->timer_.start();
+}
+
+
+
+void SpiSamplingPipeline::stop()
+{
+    if(!this->isRunning_){
+        return;
+    }
+    this->timer_.stop();
+    this->timer_.deleteIsrCallback();
+    this->timer_.deinitialize();
+    while(this->hw_->cmd.usr){
+
+    }
+    spi_device_release_bus(SpiMaster::getDeviceHandle(this->device_));
+    this->isRunning_ = false;
+}
+
+
+
+void IRAM_ATTR SpiSamplingPipeline::onTick()
+{
+    portENTER_CRITICAL_ISR(&this->mutex_);
+    const uint64_t tickNumber = this->statistics_.samplesCount++;
+    if(this->hw_->cmd.usr){
+        //period is shorter than transaction
+        this->statistics_.overrunsCount++;
+        portEXIT_CRITICAL_ISR(&this->mutex_);
+        return;
+    }
+    bool isBlockFilled = false;
+    if(this->isTransactionPending_){
+        isBlockFilled = this->storeSample(this->pendingSampleNumber_);
+    }
+    //full duplex receive overwrites transmit data in the same buffer
+    for(size_t i = 0; i < this->txWordsCount_; i++){
+        this->hw_->data_buf[i] = this->txWords_[i];
+    }
+    this->hw_->cmd.usr = 1;
+    this->isTransactionPending_ = true;
+    this->pendingSampleNumber_ = tickNumber;    //< sample is taken now, stored on the next tick
+    portEXIT_CRITICAL_ISR(&this->mutex_);
+    if(isBlockFilled){
+        BaseType_t isAwake = 0;
+        xSemaphoreGiveFromISR(this->blockSemaphore_, &isAwake);
+        if(isAwake){
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+
+
+/// Stores result of previous transaction started on tick sampleNumber. @return true if block has been filled
+bool IRAM_ATTR SpiSamplingPipeline::storeSample(uint64_t sampleNumber)
+{
+    const uint32_t writeBlock = this->writeBlock_.load(std::memory_order_relaxed);
+    if((writeBlock - this->readBlock_.load(std::memory_order_acquire)) >= this->config_.blocksCount){
+        this->statistics_.droppedSamplesCount++;
+        return false;
+    }
+    const uint32_t blockIndex = writeBlock & (this->config_.blocksCount - 1);
+    if(this->sampleIndex_ == 0){
+        this->firstSamples_[blockIndex] = sampleNumber;
+    }
+    uint32_t words[DATA_WORDS];
+    for(size_t i = 0; i < ((this->config_.sampleSize + 3U) / 4U); i++){
+        words[i] = this->hw_->data_buf[i];
+    }
+    std::memcpy(&this->blocks_[(blockIndex * this->getBlockSize()) + (this->sampleIndex_ * this->config_.sampleSize)],
+            words, this->config_.sampleSize);
+    this->sampleIndex_++;
+    if(this->sampleIndex_ < this->config_.samplesPerBlock){
+        return false;
+    }
+    this->sampleIndex_ = 0;
+    this->writeBlock_.store(writeBlock + 1, std::memory_order_release);
+    return true;
+}
+
+
+
+const uint8_t* SpiSamplingPipeline::acquireBlock(TickType_t ticksToWait, uint64_t* firstSampleNumber)
+{
+    const uint32_t readBlock = this->readBlock_.load(std::memory_order_relaxed);
+    while(this->writeBlock_.load(std::memory_order_acquire) == readBlock){
+        if(xSemaphoreTake(this->blockSemaphore_, ticksToWait) != pdTRUE){
+            return nullptr;
+        }
+    }
+    const uint32_t blockIndex = readBlock & (this->config_.blocksCount - 1);
+    if(firstSampleNumber){
+        *firstSampleNumber = this->firstSamples_[blockIndex];
+    }
+    return &this->blocks_[blockIndex * this->getBlockSize()];
+}
+
+
+
+void SpiSamplingPipeline::releaseBlock()
+{
+    const uint32_t readBlock = this->readBlock_.load(std::memory_order_relaxed);
+    if(this->writeBlock_.load(std::memory_order_acquire) != readBlock){
+        this->readBlock_.store(readBlock + 1, std::memory_order_release);
+    }
+}
+
+
+
+SpiSamplingPipeline::Statistics_t SpiSamplingPipeline::getStatistics()
+{
+    portENTER_CRITICAL(&this->mutex_);
+    auto statistics = this->statistics_;
+    portEXIT_CRITICAL(&this->mutex_);
+    return statistics;
+}
+
+#endif
@@ -31,10 +31,14 @@
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
 
 #include "jbdrivers/UartVoidChannel.hpp"
+#include "jbdrivers/Profiler.hpp"
+#include "jbdrivers/BootTiming.hpp"
 #include <esp_pthread.h>
 #include <thread>
 #include <vector>
 #include <soc/uart_reg.h>
+#include <soc/uart_periph.h>
+#include "esp_timer.h"
 
 namespace jblib
 {
@@ -47,12 +51,25 @@ namespace jblib
             #if !CONFIG_UART_CHANNEL_CONSOLE_ENABLE
             esp_log_level_set(logTag_, ESP_LOG_NONE);
             #endif
+            vPortCPUInitializeMutex(&this->rxTimestampMutex_);
         }
 
 
 
         void UartVoidChannel::initialize()
         {
+            if(this->parameters_.isLazyStart){
+                this->isStartPending_.store(true, std::memory_order_release);
+                return;
+            }
+            this->start();
+        }
+
+
+
+        void UartVoidChannel::start()
+        {
+            std::lock_guard<std::mutex> lock(this->startMutex_);
             if(!this->isInitialized_){
                 esp_err_t result;
                 uart_config_t uartConfig{};
@@ -84,9 +101,18 @@ namespace jblib
                     ESP_LOGE(logTag_, "Set flow control error");
                     return;
                 }
+                int interruptAllocFlags = this->parameters_.interruptAllocFlags;
+                if(this->parameters_.useRxTimestamps){
+                    interruptAllocFlags |= ESP_INTR_FLAG_SHARED;
+                    //start bit, data, parity and stop bits in half bits
+                    const uint32_t frameHalfBits = (2 * (1 + 5 + this->parameters_.wordLength +
+                            ((this->parameters_.parity != UART_PARITY_DISABLE) ? 1 : 0))) +
+                            (this->parameters_.stopBits + 1);
+                    this->byteTimeNs_ = static_cast<uint32_t>((frameHalfBits * 500000000ULL) / this->parameters_.baudRate);
+                }
                 result = uart_driver_install(this->parameters_.portNumber, CONFIG_UART_CHANNEL_RX_BUFFER_SIZE,
                         CONFIG_UART_CHANNEL_TX_BUFFER_SIZE, CONFIG_UART_CHANNEL_EVENT_QUEUE_SIZE,
-                        &(this->uartEventQueue_), this->parameters_.interruptAllocFlags);
+                        &(this->uartEventQueue_), interruptAllocFlags);
 
                 if(result != ESP_OK){
                     ESP_LOGE(logTag_, "Initialize uart_driver_install error");
@@ -109,6 +135,16 @@ namespace jblib
                     uart_driver_delete(this->parameters_.portNumber);
                     return;
                 }
+                if(this->parameters_.useRxTimestamps){
+                    //handlers of shared interrupt are called newest first, so FIFO is read before driver empties it
+                    result = esp_intr_alloc_intrstatus(uart_periph_signal[this->parameters_.portNumber].irq,
+                            interruptAllocFlags, UART_INT_ST_REG(this->parameters_.portNumber),
+                            UART_RXFIFO_FULL_INT_ST_M | UART_RXFIFO_TOUT_INT_ST_M,
+                            UartVoidChannel::rxTimestampIsrHandler, this, &this->rxTimestampHandle_);
+                    if(result != ESP_OK){
+                        ESP_LOGE(logTag_, "Allocate rx timestamp interrupt error %i", result);
+                    }
+                }
 
                 auto cfg = esp_pthread_get_default_config();
                 std::function<void()> eventHandlerFunc = std::bind( &UartVoidChannel::eventHandler, this);
@@ -122,7 +158,9 @@ namespace jblib
                 esp_pthread_set_cfg(&cfg);
                 std::thread handlerThread(eventHandlerFunc);
                 handlerThread.detach();
-                this->isInitialized_ = true;
+                this->isStartPending_.store(false, std::memory_order_relaxed);
+                this->isInitialized_.store(true, std::memory_order_release);
+                JB_BOOT_MARK("UART start");
             }
         }
 
@@ -133,6 +171,7 @@ namespace jblib
             uart_event_t event;
             while(true){
                 if (xQueueReceive(this->uartEventQueue_, &event, portMAX_DELAY) == pdTRUE) {
+                    JB_PROFILE_SCOPE(PROFILER_PROBE_UART_EVENT);
                     switch (event.type) {
 
                         case UART_DATA:
@@ -145,7 +184,16 @@ namespace jblib
                                                          length, portMAX_DELAY);
                                 stats_.rxEventsCount++;
                                 stats_.rxBytesCount += length;
-                                this->invokeCallback(data.data(), length, this, nullptr);
+                                if(this->rxTimestampHandle_){
+                                    int64_t timestampUs = this->getChunkTimestamp(length);
+                                    portENTER_CRITICAL(&this->rxTimestampMutex_);
+                                    this->rxTimestampUs_ = timestampUs;
+                                    portEXIT_CRITICAL(&this->rxTimestampMutex_);
+                                    this->invokeCallback(data.data(), length, this, &timestampUs);
+                                }
+                                else{
+                                    this->invokeCallback(data.data(), length, this, nullptr);
+                                }
                             }
                             else{
                                 ESP_LOGE(logTag_, "Uart received 0 bytes");
@@ -159,6 +207,7 @@ namespace jblib
                             stats_.fifoOverflowEventsCount++;
                             uart_flush_input(this->parameters_.portNumber);
                             xQueueReset(this->uartEventQueue_);
+                            this->resetRxTimestamps();
                         }
                             break;
 
@@ -168,6 +217,7 @@ namespace jblib
                             stats_.ringBufferFullEventsCount++;
                             uart_flush_input(this->parameters_.portNumber);
                             xQueueReset(this->uartEventQueue_);
+                            this->resetRxTimestamps();
                         }
                             break;
 
@@ -204,9 +254,73 @@ namespace jblib
 
 
 
+        void IRAM_ATTR UartVoidChannel::rxTimestampIsrHandler(void* arg)
+        {
+            const int64_t timeUs = esp_timer_get_time();
+            auto channel = reinterpret_cast<UartVoidChannel*>(arg);
+            const uart_port_t port = channel->parameters_.portNumber;
+            const uint32_t status = READ_PERI_REG(UART_INT_ST_REG(port));
+            const uint32_t fifoCount = (READ_PERI_REG(UART_STATUS_REG(port)) & UART_RXFIFO_CNT_M) >> UART_RXFIFO_CNT_S;
+            if(!fifoCount){
+                return;
+            }
+            //timeout interrupt is raised RX timeout threshold byte times after the last byte
+            const uint64_t fifoTimeNs = static_cast<uint64_t>(channel->byteTimeNs_) * (fifoCount +
+                    ((status & UART_RXFIFO_TOUT_INT_ST_M) ? CONFIG_UART_CHANNEL_RX_TIMEOUT_TRESHOLD : 0));
+            const uint32_t bytesOffset = channel->isrBytesCount_.load(std::memory_order_relaxed);
+            channel->isrBytesCount_.store(bytesOffset + fifoCount, std::memory_order_relaxed);
+            const uint32_t head = channel->rxMarksHead_.load(std::memory_order_relaxed);
+            if((head - channel->rxMarksTail_.load(std::memory_order_acquire)) >= RX_MARKS_RING_SIZE){
+                return;
+            }
+            channel->rxMarks_[head & (RX_MARKS_RING_SIZE - 1)] =
+                    RxMark_t{bytesOffset, timeUs - static_cast<int64_t>(fifoTimeNs / 1000)};
+            channel->rxMarksHead_.store(head + 1, std::memory_order_release);
+        }
+
+
+
+        /// Time of the first delivered byte from the latest mark at or before it
+        int64_t UartVoidChannel::getChunkTimestamp(size_t length)
+        {
+            const uint32_t head = this->rxMarksHead_.load(std::memory_order_acquire);
+            uint32_t tail = this->rxMarksTail_.load(std::memory_order_relaxed);
+            while((head - tail) >= 2){
+                const RxMark_t& nextMark = this->rxMarks_[(tail + 1) & (RX_MARKS_RING_SIZE - 1)];
+                if(static_cast<int32_t>(nextMark.bytesOffset - this->deliveredBytesCount_) > 0){
+                    break;
+                }
+                tail++;
+            }
+            int64_t timeUs = 0;
+            if(head != tail){
+                const RxMark_t& mark = this->rxMarks_[tail & (RX_MARKS_RING_SIZE - 1)];
+                const auto bytesCount = static_cast<int32_t>(this->deliveredBytesCount_ - mark.bytesOffset);
+                timeUs = mark.timeUs + ((static_cast<int64_t>(bytesCount) * this->byteTimeNs_) / 1000);
+            }
+            this->rxMarksTail_.store(tail, std::memory_order_release);
+            this->deliveredBytesCount_ += length;
+            return timeUs;
+        }
+
+
+
+        /// Bytes accounting is lost when driver flushes input
+        void UartVoidChannel::resetRxTimestamps()
+        {
+            this->rxMarksTail_.store(this->rxMarksHead_.load(std::memory_order_acquire), std::memory_order_release);
+            this->deliveredBytesCount_ = this->isrBytesCount_.load(std::memory_order_relaxed);
+        }
+
+
+
         void UartVoidChannel::tx(uint8_t* data, uint16_t size, void* connectionParameter)
         {
             (void)connectionParameter;
+            if(!this->isInitialized_.load(std::memory_order_acquire) &&
+                    this->isStartPending_.load(std::memory_order_acquire)){
+                this->start();
+            }
             if(this->isInitialized_) {
                 int length = uart_write_bytes(this->parameters_.portNumber, reinterpret_cast<char*>(data), size);
                 if(length < size){
@@ -219,17 +333,32 @@ namespace jblib
 
         UartVoidChannel::~UartVoidChannel()
         {
-            if(this-isInitialized_){
+            std::lock_guard<std::mutex> startLock(this->startMutex_);
+            if(this->isInitialized_){
                 std::unique_lock<std::mutex> lock(this->threadExitCvMutex_);
                 uart_event_t event = {UART_EVENT_MAX, 0, false};
                 xQueueSend(this->uartEventQueue_, &event, portMAX_DELAY);
                 this->threadExitCv_.wait(lock);
+                if(this->rxTimestampHandle_){
+                    esp_intr_free(this->rxTimestampHandle_);
+                    this->rxTimestampHandle_ = nullptr;
+                }
                 uart_driver_delete(this->parameters_.portNumber);
                 this->isInitialized_ = false;
                 ESP_LOGE(logTag_, "Destruct success");
             }
         }
 
+        int64_t UartVoidChannel::getLastRxTimestampUs() const
+        {
+            portENTER_CRITICAL(&this->rxTimestampMutex_);
+            const int64_t timestampUs = this->rxTimestampUs_;
+            portEXIT_CRITICAL(&this->rxTimestampMutex_);
+            return timestampUs;
+        }
+
+
+
         UartVoidChannelStats_t *UartVoidChannel::getStatistics() {
             return &stats_;
         }
@@ -30,30 +30,56 @@
 #include "jbkernel/jb_common.h"
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
 
+#include <new>
+#include <type_traits>
 #include "jbdrivers/VoidTimer.hpp"
+#include "soc/timer_group_struct.h"
 
 using namespace ::jblib::jbkernel;
 using namespace ::jblib::jbdrivers;
 
 VoidTimer& VoidTimer::getVoidTimer(TimerNum_t number, int intrFlags)
 {
-    static VoidTimer* voidTimers[TIMER_MAX]{};
-    if(number >= TIMER_MAX){
+    VoidTimer* timer = nullptr;
+    if(getVoidTimer(number, timer, intrFlags) != ESP_OK){
+        #if CONFIG_COMPILER_CXX_EXCEPTIONS
         throw std::invalid_argument("Wrong timer number");
+        #else
+        ESP_LOGE(logTag_, "Wrong timer number %i", number);
+        abort();
+        #endif
+    }
+    return *timer;
+}
+
+
+
+/// Timers are constructed in static storage on first request, constructor only initializes fields
+esp_err_t VoidTimer::getVoidTimer(TimerNum_t number, VoidTimer*& timer, int intrFlags) noexcept
+{
+    typedef std::aligned_storage<sizeof(VoidTimer), alignof(VoidTimer)>::type Storage_t;
+    static Storage_t storage[TIMER_MAX];
+    static VoidTimer* voidTimers[TIMER_MAX]{};
+    static portMUX_TYPE mutex = portMUX_INITIALIZER_UNLOCKED;
+    if((number < TIMER0_GROUP0) || (number >= TIMER_MAX)){
+        timer = nullptr;
+        return ESP_ERR_INVALID_ARG;
     }
+    portENTER_CRITICAL_SAFE(&mutex);
     if(!voidTimers[number]){
-        voidTimers[number] = new VoidTimer(number, intrFlags);
-        if(!voidTimers[number]){
-            throw std::bad_alloc();
-        }
+        voidTimers[number] = new(&storage[number]) VoidTimer(number, intrFlags);
     }
-    return *voidTimers[number];
+    timer = voidTimers[number];
+    portEXIT_CRITICAL_SAFE(&mutex);
+    return ESP_OK;
 }
 
 
 
 VoidTimer::VoidTimer(TimerNum_t number, int intrFlags) : IVoidTimer(), intrFlags_(intrFlags)
 {
+    vPortCPUInitializeMutex(&this->jitterMutex_);
+    vPortCPUInitializeMutex(&this->alarmMutex_);
     this->timerGroup_ = static_cast<timer_group_t>((static_cast<uint32_t>(number) & 2U) >> 1U);
     this->timerIdx_ = static_cast<timer_idx_t>(static_cast<uint32_t>(number) & 1U);
 }
@@ -62,39 +88,243 @@ VoidTimer::VoidTimer(TimerNum_t number, int intrFlags) : IVoidTimer(), intrFlags
 
 void VoidTimer::initialize(uint32_t periodUs)
 {
-    this->initializeTicks(US_TICKS * periodUs);
+    this->initializeTicks64(this->nsToTicks(static_cast<uint64_t>(periodUs) * 1000));
 }
 
 
 
 void VoidTimer::initializeTicks(uint32_t periodTicks)
+{
+    this->initializeTicks64(periodTicks);
+}
+
+
+
+void VoidTimer::initializeTicks64(uint64_t periodTicks)
+{
+    this->initializeTimer(periodTicks, false);
+}
+
+
+
+void VoidTimer::initializeOneShot()
+{
+    this->initializeTimer(UINT64_MAX, true);
+}
+
+
+
+void VoidTimer::initializeTimer(uint64_t periodTicks, bool isOneShot)
 {
     timer_config_t config{};
-    config.divider = DIVIDER,
+    config.divider = this->divider_,
     config.counter_dir = TIMER_COUNT_UP,
     config.counter_en = TIMER_PAUSE,
-    config.alarm_en = TIMER_ALARM_EN,
-    config.auto_reload = TIMER_AUTORELOAD_EN,
+    config.alarm_en = isOneShot ? TIMER_ALARM_DIS : TIMER_ALARM_EN,
+    config.auto_reload = isOneShot ? TIMER_AUTORELOAD_DIS : TIMER_AUTORELOAD_EN,
     config.intr_type = TIMER_INTR_LEVEL,
 
     timer_init(this->timerGroup_, this->timerIdx_, &config);
     timer_set_counter_value(this->timerGroup_, this->timerIdx_, 0ULL);
     timer_set_alarm_value(this->timerGroup_, this->timerIdx_, periodTicks);
+    this->periodTicks_ = periodTicks;
+    this->isOneShot_ = isOneShot;
+    //alarm set closer than this to the counter may be missed, ~2 us
+    this->minAlarmTicks_ = (this->getTickFrequency() / 500000) + 2;
     timer_enable_intr(this->timerGroup_, this->timerIdx_);
-    timer_isr_callback_add(this->timerGroup_, this->timerIdx_, VoidTimer::isrHandler,
-            this, this->intrFlags_);
+    //own ISR instead of IDF callback dispatcher, counter is reloaded by hardware on alarm
+    auto ret = timer_isr_register(this->timerGroup_, this->timerIdx_, VoidTimer::isrHandler,
+            this, this->intrFlags_, &this->isrHandle_);
+    if(ret != ESP_OK){
+        ESP_LOGE(logTag_, "Register timer ISR error %i", ret);
+    }
 }
 
 
 
-bool IRAM_ATTR VoidTimer::isrHandler(void* instance)
+void IRAM_ATTR VoidTimer::isrHandler(void* instance)
 {
     auto timer = reinterpret_cast<VoidTimer*>(instance);
-    timer->setCounter(0);
-    if(timer->callback_ != nullptr){
+    if(timer->isOneShot_){
+        //alarm cancelled after interrupt was raised is consumed silently
+        portENTER_CRITICAL_ISR(&timer->alarmMutex_);
+        timer_group_clr_intr_status_in_isr(timer->timerGroup_, timer->timerIdx_);
+        const bool isArmed = timer->isArmed_;
+        timer->isArmed_ = false;
+        portEXIT_CRITICAL_ISR(&timer->alarmMutex_);
+        if(!isArmed){
+            return;
+        }
+    }
+    else{
+        if(timer->isJitterMeasurementEnabled_){
+            timer->measureJitter();
+        }
+        timer_group_clr_intr_status_in_isr(timer->timerGroup_, timer->timerIdx_);
+        timer_group_enable_alarm_in_isr(timer->timerGroup_, timer->timerIdx_);
+    }
+    portENTER_CRITICAL_ISR(&timer->alarmMutex_);
+    const IsrDelegate isrCallback = timer->isrCallback_;
+    void* const parameter = timer->callbackParameter_;
+    portEXIT_CRITICAL_ISR(&timer->alarmMutex_);
+    if(isrCallback){
+        isrCallback(instance, parameter);
+    }
+    else if(timer->callback_ != nullptr){
         timer->callback_(instance, timer->callbackParameter_);
     }
-    return false;
+}
+
+
+
+/// One-shot mode alarm at absolute counter value, fires as soon as possible if value is already passed
+void IRAM_ATTR VoidTimer::setAlarm64(uint64_t ticks)
+{
+    timg_dev_t& timerGroup = (this->timerGroup_ == TIMER_GROUP_0) ? TIMERG0 : TIMERG1;
+    portENTER_CRITICAL_SAFE(&this->alarmMutex_);
+    //interrupt left pending by previous alarm would be taken as the new one
+    timer_group_clr_intr_status_in_isr(this->timerGroup_, this->timerIdx_);
+    this->isArmed_ = true;
+    timer_group_set_alarm_value_in_isr(this->timerGroup_, this->timerIdx_, ticks);
+    timer_group_enable_alarm_in_isr(this->timerGroup_, this->timerIdx_);
+    uint64_t counter = timer_group_get_counter_value_in_isr(this->timerGroup_, this->timerIdx_);
+    //comparator doesn't match values behind the counter, hardware clears alarm_en when alarm has fired
+    while((counter >= ticks) && timerGroup.hw_timer[this->timerIdx_].config.alarm_en){
+        ticks = counter + this->minAlarmTicks_;
+        timer_group_set_alarm_value_in_isr(this->timerGroup_, this->timerIdx_, ticks);
+        counter = timer_group_get_counter_value_in_isr(this->timerGroup_, this->timerIdx_);
+    }
+    portEXIT_CRITICAL_SAFE(&this->alarmMutex_);
+}
+
+
+
+void IRAM_ATTR VoidTimer::armAt(uint64_t ticks)
+{
+    if(!this->isOneShot_){
+        ESP_EARLY_LOGE(logTag_, "Timer is not in one-shot mode");
+        return;
+    }
+    this->setAlarm64(ticks);
+}
+
+
+
+void IRAM_ATTR VoidTimer::armAtNs(uint64_t ns)
+{
+    this->armAt(this->nsToTicks(ns));
+}
+
+
+
+void IRAM_ATTR VoidTimer::armAfter(uint64_t ticks)
+{
+    this->armAt(timer_group_get_counter_value_in_isr(this->timerGroup_, this->timerIdx_) + ticks);
+}
+
+
+
+bool IRAM_ATTR VoidTimer::cancelAlarm()
+{
+    timg_dev_t& timerGroup = (this->timerGroup_ == TIMER_GROUP_0) ? TIMERG0 : TIMERG1;
+    portENTER_CRITICAL_SAFE(&this->alarmMutex_);
+    const bool isArmed = this->isArmed_;
+    this->isArmed_ = false;
+    timerGroup.hw_timer[this->timerIdx_].config.alarm_en = 0;
+    timer_group_clr_intr_status_in_isr(this->timerGroup_, this->timerIdx_);
+    portEXIT_CRITICAL_SAFE(&this->alarmMutex_);
+    return isArmed;
+}
+
+
+
+void IRAM_ATTR VoidTimer::measureJitter()
+{
+    const auto latencyTicks = static_cast<uint32_t>(
+            timer_group_get_counter_value_in_isr(this->timerGroup_, this->timerIdx_));
+    portENTER_CRITICAL_ISR(&this->jitterMutex_);
+    auto& statistics = this->jitterStatistics_;
+    //counter is reloaded to zero on alarm, so alarm base advances by period in force for this alarm
+    this->alarmBaseTicks_ += this->periodTicks_;
+    this->alarms_[statistics.alarmsCount & (ALARMS_RING_SIZE - 1)] = this->alarmBaseTicks_ + latencyTicks;
+    statistics.alarmsCount++;
+    statistics.latencySumTicks += latencyTicks;
+    if(latencyTicks < statistics.minLatencyTicks){
+        statistics.minLatencyTicks = latencyTicks;
+    }
+    if(latencyTicks > statistics.maxLatencyTicks){
+        statistics.maxLatencyTicks = latencyTicks;
+    }
+    portEXIT_CRITICAL_ISR(&this->jitterMutex_);
+}
+
+
+
+void VoidTimer::enableJitterMeasurement(bool isEnabled)
+{
+    if(isEnabled && !this->alarms_){
+        this->alarms_ = std::unique_ptr<uint64_t[]>(new uint64_t[ALARMS_RING_SIZE]);
+    }
+    this->resetJitterStatistics();
+    this->isJitterMeasurementEnabled_ = isEnabled;
+}
+
+
+
+VoidTimer::JitterStatistics_t VoidTimer::getJitterStatistics()
+{
+    portENTER_CRITICAL(&this->jitterMutex_);
+    const auto statistics = this->jitterStatistics_;
+    portEXIT_CRITICAL(&this->jitterMutex_);
+    return statistics;
+}
+
+
+
+size_t VoidTimer::getAlarmTimestamps(uint64_t* timestamps, size_t maxCount)
+{
+    if(!this->alarms_){
+        return 0;
+    }
+    size_t count = 0;
+    portENTER_CRITICAL(&this->jitterMutex_);
+    const uint32_t alarmsCount = this->jitterStatistics_.alarmsCount;
+    while((count < maxCount) && (count < alarmsCount) && (count < ALARMS_RING_SIZE)){
+        timestamps[count] = this->alarms_[(alarmsCount - 1 - count) & (ALARMS_RING_SIZE - 1)];
+        count++;
+    }
+    portEXIT_CRITICAL(&this->jitterMutex_);
+    return count;
+}
+
+
+
+void VoidTimer::resetJitterStatistics()
+{
+    const uint64_t counter = this->getCounter64();
+    portENTER_CRITICAL(&this->jitterMutex_);
+    this->jitterStatistics_ = JitterStatistics_t();
+    this->alarmBaseTicks_ = 0 - counter;   //< timestamps count from now, wraps back on first alarm
+    portEXIT_CRITICAL(&this->jitterMutex_);
+}
+
+
+
+void VoidTimer::addIsrCallback(const IsrDelegate& callback, void* parameter)
+{
+    portENTER_CRITICAL(&this->alarmMutex_);
+    this->isrCallback_ = callback;
+    this->callbackParameter_ = parameter;
+    portEXIT_CRITICAL(&this->alarmMutex_);
+}
+
+
+
+void VoidTimer::deleteIsrCallback()
+{
+    portENTER_CRITICAL(&this->alarmMutex_);
+    this->isrCallback_ = IsrDelegate();
+    portEXIT_CRITICAL(&this->alarmMutex_);
 }
 
 
@@ -102,7 +332,10 @@ bool IRAM_ATTR VoidTimer::isrHandler(void* instance)
 void VoidTimer::deinitialize()
 {
     this->stop();
-    timer_isr_callback_remove(this->timerGroup_, this->timerIdx_);
+    if(this->isrHandle_){
+        esp_intr_free(this->isrHandle_);
+        this->isrHandle_ = nullptr;
+    }
     timer_deinit(this->timerGroup_, this->timerIdx_);
 }
 
@@ -122,6 +355,13 @@ void VoidTimer::stop()
 
 
 
+void IRAM_ATTR VoidTimer::stopFromIsr()
+{
+    timer_group_set_counter_enable_in_isr(this->timerGroup_, this->timerIdx_, TIMER_PAUSE);
+}
+
+
+
 void VoidTimer::reset()
 {
     this->setCounter(0);
@@ -130,6 +370,13 @@ void VoidTimer::reset()
 
 
 uint32_t VoidTimer::getCounter()
+{
+    return static_cast<uint32_t>(this->getCounter64());
+}
+
+
+
+uint64_t VoidTimer::getCounter64()
 {
     uint64_t ret = 0;
     timer_get_counter_value(this->timerGroup_, this->timerIdx_, &ret);
@@ -138,37 +385,104 @@ uint32_t VoidTimer::getCounter()
 
 
 
+uint64_t VoidTimer::getNsecCounter()
+{
+    return this->ticksToNs(this->getCounter64());
+}
+
+
+
 uint32_t VoidTimer::getUsecCounter()
 {
-    return (static_cast<uint64_t>(this->getCounter()) / US_TICKS);
+    return static_cast<uint32_t>(this->getNsecCounter() / 1000);
 }
 
 
 
 void VoidTimer::setCounter(uint32_t ticks)
 {
+    this->setCounter64(ticks);
+}
+
+
+
+void VoidTimer::setCounter64(uint64_t ticks)
+{
+    //keep alarm timestamps continuous: time passed so far is alarm base plus counter before the jump
+    portENTER_CRITICAL(&this->jitterMutex_);
+    this->alarmBaseTicks_ += this->getCounter64() - ticks;
     timer_set_counter_value(this->timerGroup_, this->timerIdx_, ticks);
+    portEXIT_CRITICAL(&this->jitterMutex_);
+    if(ticks){
+        //driver sets counter through reload register, restore zero reload value for hardware auto-reload
+        timg_dev_t& timerGroup = (this->timerGroup_ == TIMER_GROUP_0) ? TIMERG0 : TIMERG1;
+        timerGroup.hw_timer[this->timerIdx_].load_high = 0;
+        timerGroup.hw_timer[this->timerIdx_].load_low = 0;
+    }
 }
 
 
 
 void VoidTimer::setUsecCounter(uint32_t us)
 {
-    this->setCounter(US_TICKS * us);
+    this->setCounter64(this->nsToTicks(static_cast<uint64_t>(us) * 1000));
 }
 
 
 
 void VoidTimer::changePeriod(uint32_t periodUs)
 {
-    this->changePeriodTicks(US_TICKS * periodUs);
+    this->changePeriodNs(static_cast<uint64_t>(periodUs) * 1000);
 }
 
 
 
 void VoidTimer::changePeriodTicks(uint32_t periodTicks)
+{
+    this->changePeriodTicks64(periodTicks);
+}
+
+
+
+void VoidTimer::changePeriodNs(uint64_t periodNs)
+{
+    this->changePeriodTicks64(this->nsToTicks(periodNs));
+}
+
+
+
+void VoidTimer::setDivider(uint32_t divider)
+{
+    if((divider < 2) || (divider > 65536)){
+        ESP_LOGE(logTag_, "Wrong divider %u", divider);
+        return;
+    }
+    this->divider_ = divider;
+}
+
+
+
+uint64_t VoidTimer::ticksToNs(uint64_t ticks) const
+{
+    //split to avoid overflow of 64-bit product
+    const uint64_t frequency = this->getTickFrequency();
+    return ((ticks / frequency) * 1000000000ULL) + (((ticks % frequency) * 1000000000ULL) / frequency);
+}
+
+
+
+uint64_t VoidTimer::nsToTicks(uint64_t ns) const
+{
+    const uint64_t frequency = this->getTickFrequency();
+    return ((ns / 1000000000ULL) * frequency) + (((ns % 1000000000ULL) * frequency) / 1000000000ULL);
+}
+
+
+
+void VoidTimer::changePeriodTicks64(uint64_t periodTicks)
 {
     timer_set_alarm_value(this->timerGroup_, this->timerIdx_, periodTicks);
+    this->periodTicks_ = periodTicks;
 }
 
 #endif
\ No newline at end of file